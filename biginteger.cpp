@@ -0,0 +1,88 @@
+#include "biginteger.h"
+#include <algorithm>
+
+using namespace std;
+
+void BigUnsigned::divide(const BigUnsigned & dividend, const BigUnsigned & divisor, BigUnsigned & quotient, BigUnsigned & remainder)
+{
+    assert(!divisor.isZero());
+    if(divisor.words.size() == 1)
+    {
+        DoubleWord d = divisor.words[0], r = 0;
+        vector<Word> q(dividend.words.size(), 0);
+        for(size_t i = dividend.words.size(); i-- > 0;)
+        {
+            r = (r << WordSize) | dividend.words[i];
+            q[i] = (Word)(r / d);
+            r %= d;
+        }
+        quotient = fromWords(std::move(q));
+        remainder = BigUnsigned(r);
+        return;
+    }
+    quotient = BigUnsigned();
+    remainder = BigUnsigned();
+    if(dividend < divisor)
+    {
+        remainder = dividend;
+        return;
+    }
+    // shift and subtract
+    vector<Word> q(dividend.words.size(), 0);
+    for(size_t i = dividend.bitLength(); i-- > 0;)
+    {
+        remainder <<= 1;
+        if(dividend.getBit(i))
+        {
+            if(remainder.words.empty())
+                remainder.words.push_back(0);
+            remainder.words[0] |= 1;
+        }
+        if(remainder >= divisor)
+        {
+            remainder -= divisor;
+            q[i / WordSize] |= (Word)1 << (i % WordSize);
+        }
+    }
+    quotient = fromWords(std::move(q));
+}
+
+string BigUnsigned::toString() const
+{
+    if(words.empty())
+        return "0";
+    string retval;
+    BigUnsigned v = *this, quotient, remainder;
+    const BigUnsigned chunkDivisor(1000000000);
+    while(!v.isZero())
+    {
+        divide(v, chunkDivisor, quotient, remainder);
+        Word chunk = (Word)remainder.toUInt64();
+        for(int i = 0; i < 9; i++)
+        {
+            retval += (char)('0' + chunk % 10);
+            chunk /= 10;
+            if(chunk == 0 && quotient.isZero())
+                break;
+        }
+        v = quotient;
+    }
+    reverse(retval.begin(), retval.end());
+    return retval;
+}
+
+bool BigUnsigned::parse(string str, BigUnsigned & result)
+{
+    if(str.empty())
+        return false;
+    BigUnsigned retval;
+    const BigUnsigned ten(10);
+    for(char ch : str)
+    {
+        if(ch < '0' || ch > '9')
+            return false;
+        retval = retval * ten + BigUnsigned(ch - '0');
+    }
+    result = retval;
+    return true;
+}
@@ -0,0 +1,410 @@
+#ifndef BIGINTEGER_H_INCLUDED
+#define BIGINTEGER_H_INCLUDED
+
+#include <cstdint>
+#include <vector>
+#include <string>
+#include <istream>
+#include <ostream>
+#include <cassert>
+
+using namespace std;
+
+class BigUnsigned
+{
+public:
+    typedef uint32_t Word;
+    static constexpr int WordSize = 32;
+private:
+    typedef uint64_t DoubleWord;
+    vector<Word> words; // least significant first, never ends in a zero word
+    void normalize()
+    {
+        while(!words.empty() && words.back() == 0)
+            words.pop_back();
+    }
+public:
+    BigUnsigned(uint64_t v = 0)
+    {
+        while(v != 0)
+        {
+            words.push_back((Word)v);
+            v >>= WordSize;
+        }
+    }
+    static BigUnsigned fromWords(vector<Word> words)
+    {
+        BigUnsigned retval;
+        retval.words = std::move(words);
+        retval.normalize();
+        return retval;
+    }
+    const vector<Word> & getWords() const
+    {
+        return words;
+    }
+    bool isZero() const
+    {
+        return words.empty();
+    }
+    explicit operator bool() const
+    {
+        return !words.empty();
+    }
+    bool operator !() const
+    {
+        return words.empty();
+    }
+    size_t bitLength() const
+    {
+        if(words.empty())
+            return 0;
+        size_t retval = (words.size() - 1) * WordSize;
+        for(Word v = words.back(); v != 0; v >>= 1)
+            retval++;
+        return retval;
+    }
+    bool getBit(size_t index) const
+    {
+        if(index / WordSize >= words.size())
+            return false;
+        return (words[index / WordSize] >> (index % WordSize)) & 1;
+    }
+    size_t trailingZeroCount() const // of a nonzero value
+    {
+        assert(!words.empty());
+        size_t retval = 0;
+        while(!getBit(retval))
+            retval++;
+        return retval;
+    }
+    bool fitsInUInt64() const
+    {
+        return words.size() <= 2;
+    }
+    uint64_t toUInt64() const // the low 64 bits
+    {
+        uint64_t retval = 0;
+        if(words.size() > 1)
+            retval = (uint64_t)words[1] << WordSize;
+        if(words.size() > 0)
+            retval |= words[0];
+        return retval;
+    }
+    explicit operator double() const
+    {
+        double retval = 0;
+        for(size_t i = words.size(); i-- > 0;)
+            retval = retval * 4294967296.0 + words[i];
+        return retval;
+    }
+    friend int compare(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        if(a.words.size() != b.words.size())
+            return a.words.size() < b.words.size() ? -1 : 1;
+        for(size_t i = a.words.size(); i-- > 0;)
+        {
+            if(a.words[i] != b.words[i])
+                return a.words[i] < b.words[i] ? -1 : 1;
+        }
+        return 0;
+    }
+    friend bool operator ==(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        return a.words == b.words;
+    }
+    friend bool operator !=(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        return a.words != b.words;
+    }
+    friend bool operator <(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        return compare(a, b) < 0;
+    }
+    friend bool operator <=(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        return compare(a, b) <= 0;
+    }
+    friend bool operator >(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        return compare(a, b) > 0;
+    }
+    friend bool operator >=(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        return compare(a, b) >= 0;
+    }
+    const BigUnsigned & operator +=(const BigUnsigned & r)
+    {
+        if(words.size() < r.words.size())
+            words.resize(r.words.size(), 0);
+        DoubleWord carry = 0;
+        for(size_t i = 0; i < words.size(); i++)
+        {
+            carry += words[i];
+            if(i < r.words.size())
+                carry += r.words[i];
+            words[i] = (Word)carry;
+            carry >>= WordSize;
+        }
+        if(carry != 0)
+            words.push_back((Word)carry);
+        return *this;
+    }
+    friend BigUnsigned operator +(BigUnsigned a, const BigUnsigned & b)
+    {
+        return a += b;
+    }
+    const BigUnsigned & operator -=(const BigUnsigned & r) // r must not be bigger than *this
+    {
+        assert(*this >= r);
+        DoubleWord borrow = 0;
+        for(size_t i = 0; i < words.size(); i++)
+        {
+            DoubleWord subtrahend = borrow + (i < r.words.size() ? r.words[i] : 0);
+            borrow = (words[i] < subtrahend ? 1 : 0);
+            words[i] = (Word)((DoubleWord)words[i] - subtrahend);
+        }
+        normalize();
+        return *this;
+    }
+    friend BigUnsigned operator -(BigUnsigned a, const BigUnsigned & b)
+    {
+        return a -= b;
+    }
+    friend BigUnsigned operator *(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        BigUnsigned retval;
+        if(a.words.empty() || b.words.empty())
+            return retval;
+        retval.words.assign(a.words.size() + b.words.size(), 0);
+        for(size_t i = 0; i < a.words.size(); i++)
+        {
+            DoubleWord carry = 0;
+            for(size_t j = 0; j < b.words.size(); j++)
+            {
+                carry += (DoubleWord)a.words[i] * b.words[j] + retval.words[i + j];
+                retval.words[i + j] = (Word)carry;
+                carry >>= WordSize;
+            }
+            retval.words[i + b.words.size()] = (Word)carry;
+        }
+        retval.normalize();
+        return retval;
+    }
+    const BigUnsigned & operator *=(const BigUnsigned & r)
+    {
+        return *this = *this * r;
+    }
+    friend BigUnsigned operator <<(const BigUnsigned & v, size_t shift)
+    {
+        BigUnsigned retval;
+        if(v.words.empty())
+            return retval;
+        size_t wordShift = shift / WordSize, bitShift = shift % WordSize;
+        retval.words.assign(v.words.size() + wordShift + 1, 0);
+        for(size_t i = 0; i < v.words.size(); i++)
+        {
+            DoubleWord shifted = (DoubleWord)v.words[i] << bitShift;
+            retval.words[i + wordShift] |= (Word)shifted;
+            retval.words[i + wordShift + 1] |= (Word)(shifted >> WordSize);
+        }
+        retval.normalize();
+        return retval;
+    }
+    const BigUnsigned & operator <<=(size_t shift)
+    {
+        return *this = *this << shift;
+    }
+    friend BigUnsigned operator >>(const BigUnsigned & v, size_t shift)
+    {
+        BigUnsigned retval;
+        size_t wordShift = shift / WordSize, bitShift = shift % WordSize;
+        if(wordShift >= v.words.size())
+            return retval;
+        retval.words.assign(v.words.size() - wordShift, 0);
+        for(size_t i = 0; i < retval.words.size(); i++)
+        {
+            DoubleWord value = v.words[i + wordShift];
+            if(i + wordShift + 1 < v.words.size())
+                value |= (DoubleWord)v.words[i + wordShift + 1] << WordSize;
+            retval.words[i] = (Word)(value >> bitShift);
+        }
+        retval.normalize();
+        return retval;
+    }
+    const BigUnsigned & operator >>=(size_t shift)
+    {
+        return *this = *this >> shift;
+    }
+    // sets quotient and remainder; divisor must be nonzero
+    static void divide(const BigUnsigned & dividend, const BigUnsigned & divisor, BigUnsigned & quotient, BigUnsigned & remainder);
+    friend BigUnsigned operator /(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        BigUnsigned quotient, remainder;
+        divide(a, b, quotient, remainder);
+        return quotient;
+    }
+    friend BigUnsigned operator %(const BigUnsigned & a, const BigUnsigned & b)
+    {
+        BigUnsigned quotient, remainder;
+        divide(a, b, quotient, remainder);
+        return remainder;
+    }
+    string toString() const; // in decimal
+    static bool parse(string str, BigUnsigned & result); // decimal digits only
+    friend ostream & operator <<(ostream & os, const BigUnsigned & v)
+    {
+        return os << v.toString();
+    }
+    friend istream & operator >>(istream & is, BigUnsigned & v)
+    {
+        string str;
+        if(is >> str && !parse(str, v))
+            is.setstate(ios::failbit);
+        return is;
+    }
+};
+
+class BigInteger
+{
+private:
+    bool negative = false; // never set for zero
+    BigUnsigned magnitude;
+    void normalize()
+    {
+        if(magnitude.isZero())
+            negative = false;
+    }
+public:
+    BigInteger(int64_t v = 0)
+        : negative(v < 0), magnitude(v < 0 ? -(uint64_t)v : (uint64_t)v)
+    {
+    }
+    BigInteger(BigUnsigned magnitude, bool negative = false)
+        : negative(negative), magnitude(std::move(magnitude))
+    {
+        normalize();
+    }
+    bool isNegative() const
+    {
+        return negative;
+    }
+    bool isZero() const
+    {
+        return magnitude.isZero();
+    }
+    const BigUnsigned & getMagnitude() const
+    {
+        return magnitude;
+    }
+    bool fitsInInt64() const
+    {
+        if(!magnitude.fitsInUInt64())
+            return false;
+        uint64_t v = magnitude.toUInt64();
+        if(negative)
+            return v <= (uint64_t)1 << 63;
+        return v < (uint64_t)1 << 63;
+    }
+    int64_t toInt64() const // the low 64 bits of the two's complement value
+    {
+        uint64_t v = magnitude.toUInt64();
+        return (int64_t)(negative ? -v : v);
+    }
+    friend int compare(const BigInteger & a, const BigInteger & b)
+    {
+        if(a.negative != b.negative)
+            return a.negative ? -1 : 1;
+        int retval = compare(a.magnitude, b.magnitude);
+        return a.negative ? -retval : retval;
+    }
+    friend bool operator ==(const BigInteger & a, const BigInteger & b)
+    {
+        return a.negative == b.negative && a.magnitude == b.magnitude;
+    }
+    friend bool operator !=(const BigInteger & a, const BigInteger & b)
+    {
+        return !(a == b);
+    }
+    friend bool operator <(const BigInteger & a, const BigInteger & b)
+    {
+        return compare(a, b) < 0;
+    }
+    friend bool operator <=(const BigInteger & a, const BigInteger & b)
+    {
+        return compare(a, b) <= 0;
+    }
+    friend bool operator >(const BigInteger & a, const BigInteger & b)
+    {
+        return compare(a, b) > 0;
+    }
+    friend bool operator >=(const BigInteger & a, const BigInteger & b)
+    {
+        return compare(a, b) >= 0;
+    }
+    BigInteger operator -() const
+    {
+        return BigInteger(magnitude, !negative);
+    }
+    friend BigInteger operator +(const BigInteger & a, const BigInteger & b)
+    {
+        if(a.negative == b.negative)
+            return BigInteger(a.magnitude + b.magnitude, a.negative);
+        if(a.magnitude >= b.magnitude)
+            return BigInteger(a.magnitude - b.magnitude, a.negative);
+        return BigInteger(b.magnitude - a.magnitude, b.negative);
+    }
+    friend BigInteger operator -(const BigInteger & a, const BigInteger & b)
+    {
+        return a + -b;
+    }
+    const BigInteger & operator +=(const BigInteger & r)
+    {
+        return *this = *this + r;
+    }
+    const BigInteger & operator -=(const BigInteger & r)
+    {
+        return *this = *this - r;
+    }
+    friend BigInteger operator *(const BigInteger & a, const BigInteger & b)
+    {
+        return BigInteger(a.magnitude * b.magnitude, a.negative != b.negative);
+    }
+    const BigInteger & operator *=(const BigInteger & r)
+    {
+        return *this = *this * r;
+    }
+    string toString() const
+    {
+        if(negative)
+            return "-" + magnitude.toString();
+        return magnitude.toString();
+    }
+    static bool parse(string str, BigInteger & result) // optional sign then decimal digits
+    {
+        bool isNegative = false;
+        if(!str.empty() && (str[0] == '-' || str[0] == '+'))
+        {
+            isNegative = (str[0] == '-');
+            str.erase(0, 1);
+        }
+        BigUnsigned parsedMagnitude;
+        if(!BigUnsigned::parse(str, parsedMagnitude))
+            return false;
+        result = BigInteger(parsedMagnitude, isNegative);
+        return true;
+    }
+    friend ostream & operator <<(ostream & os, const BigInteger & v)
+    {
+        return os << v.toString();
+    }
+    friend istream & operator >>(istream & is, BigInteger & v)
+    {
+        string str;
+        if(is >> str && !parse(str, v))
+            is.setstate(ios::failbit);
+        return is;
+    }
+};
+
+#endif // BIGINTEGER_H_INCLUDED
@@ -0,0 +1,1819 @@
+#include "hashlife.h"
+#if defined(__unix__) || defined(__APPLE__)
+#define USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // defined(__unix__) || defined(__APPLE__)
+
+using namespace std;
+
+thread_local size_t NodeGCHashTable::mutatorScopeDepth = 0;
+thread_local uint64_t NodeGCHashTable::threadMemoHitCount = 0;
+thread_local uint64_t NodeGCHashTable::threadMemoMissCount = 0;
+
+NodeReference NodeType::getCenter(NodeGCHashTable *gc) const
+{
+    NodeReference thisRef = this;
+    if(level == 0)
+    {
+        assert(false);
+        return nullptr;
+    }
+    else if(level == 1)
+        return gc->findOrInsertLeaf(nxny.nonleaf->pxpy.leaf, nxpy.nonleaf->pxny.leaf, pxny.nonleaf->nxpy.leaf, pxpy.nonleaf->nxny.leaf);
+    else
+        return gc->findOrInsertNonleaf(nxny.nonleaf->pxpy.nonleaf, nxpy.nonleaf->pxny.nonleaf, pxny.nonleaf->nxpy.nonleaf, pxpy.nonleaf->nxny.nonleaf);
+}
+
+uint64_t NodeType::getPopulation(CellType backgroundType) const
+{
+    assert(backgroundType <= 1);
+    atomic_uint_fast64_t & cache = (backgroundType == 0 ? cachedPopulation : cachedNonOnePopulation);
+    uint64_t retval = cache.load(memory_order_relaxed);
+    if(retval != populationUnknown)
+        return retval;
+    if(level == 0)
+    {
+        retval = 0;
+        for(CellType cell : {nxny.leaf, nxpy.leaf, pxny.leaf, pxpy.leaf})
+        {
+            if(cell != backgroundType)
+                retval++;
+        }
+    }
+    else
+    {
+        retval = 0;
+        for(const NodeType * child : {nxny.nonleaf, nxpy.nonleaf, pxny.nonleaf, pxpy.nonleaf})
+        {
+            uint64_t childPopulation = child->getPopulation(backgroundType);
+            if(childPopulation == populationTooBig || childPopulation >= populationTooBig - retval)
+            {
+                retval = populationTooBig;
+                break;
+            }
+            retval += childPopulation;
+        }
+    }
+    cache.store(retval, memory_order_relaxed);
+    return retval;
+}
+
+CellColorDescriptor NodeType::getOverallCellColorDescriptor() const
+{
+    CellColorDescriptor retval = cachedOverallCellColorDescriptor.load(memory_order_relaxed);
+    if(retval != cellColorDescriptorUnknown)
+        return retval;
+    if(level == 0)
+        retval = combineCellColorDescriptors({getCellColorDescriptor(nxny.leaf), getCellColorDescriptor(nxpy.leaf), getCellColorDescriptor(pxny.leaf), getCellColorDescriptor(pxpy.leaf)});
+    else
+        retval = combineCellColorDescriptors({nxny.nonleaf->getOverallCellColorDescriptor(), nxpy.nonleaf->getOverallCellColorDescriptor(),
+                                              pxny.nonleaf->getOverallCellColorDescriptor(), pxpy.nonleaf->getOverallCellColorDescriptor()});
+    cachedOverallCellColorDescriptor.store(retval, memory_order_relaxed);
+    return retval;
+}
+
+namespace
+{
+// nodes above NodeType::maxCachedExtentLevel don't cache their extent; memo keeps shared ones from being visited twice
+NodeType::Extent getBigNodeExtent(const NodeType * node, unordered_map<const NodeType *, NodeType::Extent> & memo)
+{
+    if(node->level <= NodeType::maxCachedExtentLevel)
+        return node->getExtent();
+    NodeType::Extent retval = NodeType::Extent::makeEmpty();
+    if(node->getPopulation() == 0)
+        return retval;
+    auto iter = memo.find(node);
+    if(iter != memo.end())
+        return iter->second;
+    uint64_t halfSize = (uint64_t)1 << node->level;
+    retval.add(getBigNodeExtent(node->nxny.nonleaf, memo), 0, 0);
+    retval.add(getBigNodeExtent(node->nxpy.nonleaf, memo), 0, halfSize);
+    retval.add(getBigNodeExtent(node->pxny.nonleaf, memo), halfSize, 0);
+    retval.add(getBigNodeExtent(node->pxpy.nonleaf, memo), halfSize, halfSize);
+    memo[node] = retval;
+    return retval;
+}
+}
+
+NodeType::Extent NodeType::getExtent() const
+{
+    assert(level <= maxExtentLevel);
+    if(level > maxCachedExtentLevel)
+    {
+        unordered_map<const NodeType *, Extent> memo;
+        return getBigNodeExtent(this, memo);
+    }
+    if(extentKnown.load(memory_order_acquire))
+        return Extent{extentMinX.load(memory_order_relaxed), extentMinY.load(memory_order_relaxed), extentMaxX.load(memory_order_relaxed), extentMaxY.load(memory_order_relaxed)};
+    Extent retval = Extent::makeEmpty();
+    if(getPopulation() == 0)
+        return retval;
+    if(level == 0)
+    {
+        if(nxny.leaf != 0)
+            retval.add(Extent{0, 0, 0, 0}, 0, 0);
+        if(nxpy.leaf != 0)
+            retval.add(Extent{0, 1, 0, 1}, 0, 0);
+        if(pxny.leaf != 0)
+            retval.add(Extent{1, 0, 1, 0}, 0, 0);
+        if(pxpy.leaf != 0)
+            retval.add(Extent{1, 1, 1, 1}, 0, 0);
+    }
+    else
+    {
+        uint64_t halfSize = (uint64_t)1 << level;
+        retval.add(nxny.nonleaf->getExtent(), 0, 0);
+        retval.add(nxpy.nonleaf->getExtent(), 0, halfSize);
+        retval.add(pxny.nonleaf->getExtent(), halfSize, 0);
+        retval.add(pxpy.nonleaf->getExtent(), halfSize, halfSize);
+    }
+    // the node is at most 2^32 cells across, so the offsets fit in 32 bits
+    extentMinX.store((uint_least32_t)retval.minX, memory_order_relaxed);
+    extentMinY.store((uint_least32_t)retval.minY, memory_order_relaxed);
+    extentMaxX.store((uint_least32_t)retval.maxX, memory_order_relaxed);
+    extentMaxY.store((uint_least32_t)retval.maxY, memory_order_relaxed);
+    extentKnown.store(true, memory_order_release);
+    return retval;
+}
+
+namespace
+{
+NodeReference getNextStateOfChildren(NodeGCHashTable *gc, const Rule *rule, const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy, size_t logStepSize, StepControl *control);
+
+// the center of the node made of the four children, without putting that node in the table
+NodeReference getCenterOfChildren(NodeGCHashTable *gc, const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy)
+{
+    if(nxny->level == 0)
+        return gc->findOrInsertLeaf(nxny->pxpy.leaf, nxpy->pxny.leaf, pxny->nxpy.leaf, pxpy->nxny.leaf);
+    return gc->findOrInsertNonleaf(nxny->pxpy.nonleaf, nxpy->pxny.nonleaf, pxny->nxpy.nonleaf, pxpy->nxny.nonleaf);
+}
+
+// the next state of the node made of the four children, 2^logStepSize generations later.
+// the overlapping nodes the recursion needs are only passed around as their children, see getNextStateOfChildren
+NodeReference computeNextState(NodeGCHashTable *gc, const Rule *rule, const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy, size_t logStepSize, StepControl *control)
+{
+    size_t level = nxny->level + 1;
+    assert(level >= logStepSize + 1);
+    if(level == 1)
+    {
+        CellType new_nxny = rule->eval(nxny->nxny.leaf, nxny->nxpy.leaf, nxpy->nxny.leaf,
+                                       nxny->pxny.leaf, nxny->pxpy.leaf, nxpy->pxny.leaf,
+                                       pxny->nxny.leaf, pxny->nxpy.leaf, pxpy->nxny.leaf);
+        CellType new_nxpy = rule->eval(nxny->nxpy.leaf, nxpy->nxny.leaf, nxpy->nxpy.leaf,
+                                       nxny->pxpy.leaf, nxpy->pxny.leaf, nxpy->pxpy.leaf,
+                                       pxny->nxpy.leaf, pxpy->nxny.leaf, pxpy->nxpy.leaf);
+        CellType new_pxny = rule->eval(nxny->pxny.leaf, nxny->pxpy.leaf, nxpy->pxny.leaf,
+                                       pxny->nxny.leaf, pxny->nxpy.leaf, pxpy->nxny.leaf,
+                                       pxny->pxny.leaf, pxny->pxpy.leaf, pxpy->pxny.leaf);
+        CellType new_pxpy = rule->eval(nxny->pxpy.leaf, nxpy->pxny.leaf, nxpy->pxpy.leaf,
+                                       pxny->nxpy.leaf, pxpy->nxny.leaf, pxpy->nxpy.leaf,
+                                       pxny->pxpy.leaf, pxpy->pxny.leaf, pxpy->pxpy.leaf);
+        return gc->findOrInsertLeaf(new_nxny, new_nxpy, new_pxny, new_pxpy);
+    }
+    if(StepControl::isCancelled(control))
+        return nullptr;
+    // a full step takes two half steps; a shorter one takes a step then the center
+    size_t step1LogStepSize = (logStepSize == level - 1 ? level - 2 : logStepSize);
+    NodeReference step1_nxny = nxny->getNextState(gc, rule, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_nxny))
+        return nullptr;
+    NodeReference step1_nxpy = nxpy->getNextState(gc, rule, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_nxpy))
+        return nullptr;
+    NodeReference step1_pxny = pxny->getNextState(gc, rule, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_pxny))
+        return nullptr;
+    NodeReference step1_pxpy = pxpy->getNextState(gc, rule, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_pxpy))
+        return nullptr;
+    NodeReference step1_nxcy = getNextStateOfChildren(gc, rule, nxny->nxpy.nonleaf, nxpy->nxny.nonleaf, nxny->pxpy.nonleaf, nxpy->pxny.nonleaf, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_nxcy))
+        return nullptr;
+    NodeReference step1_pxcy = getNextStateOfChildren(gc, rule, pxny->nxpy.nonleaf, pxpy->nxny.nonleaf, pxny->pxpy.nonleaf, pxpy->pxny.nonleaf, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_pxcy))
+        return nullptr;
+    NodeReference step1_cxny = getNextStateOfChildren(gc, rule, nxny->pxny.nonleaf, nxny->pxpy.nonleaf, pxny->nxny.nonleaf, pxny->nxpy.nonleaf, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_cxny))
+        return nullptr;
+    NodeReference step1_cxpy = getNextStateOfChildren(gc, rule, nxpy->pxny.nonleaf, nxpy->pxpy.nonleaf, pxpy->nxny.nonleaf, pxpy->nxpy.nonleaf, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_cxpy))
+        return nullptr;
+    NodeReference step1_cxcy = getNextStateOfChildren(gc, rule, nxny->pxpy.nonleaf, nxpy->pxny.nonleaf, pxny->nxpy.nonleaf, pxpy->nxny.nonleaf, step1LogStepSize, control);
+    if(!StepControl::subproblemDone(control, level, step1_cxcy))
+        return nullptr;
+    NodeReference final_nxny, final_nxpy, final_pxny, final_pxpy;
+    if(logStepSize == level - 1)
+    {
+        final_nxny = getNextStateOfChildren(gc, rule, step1_nxny, step1_nxcy, step1_cxny, step1_cxcy, level - 2, control);
+        if(!StepControl::subproblemDone(control, level, final_nxny))
+            return nullptr;
+        final_nxpy = getNextStateOfChildren(gc, rule, step1_nxcy, step1_nxpy, step1_cxcy, step1_cxpy, level - 2, control);
+        if(!StepControl::subproblemDone(control, level, final_nxpy))
+            return nullptr;
+        final_pxny = getNextStateOfChildren(gc, rule, step1_cxny, step1_cxcy, step1_pxny, step1_pxcy, level - 2, control);
+        if(!StepControl::subproblemDone(control, level, final_pxny))
+            return nullptr;
+        final_pxpy = getNextStateOfChildren(gc, rule, step1_cxcy, step1_cxpy, step1_pxcy, step1_pxpy, level - 2, control);
+        if(!StepControl::subproblemDone(control, level, final_pxpy))
+            return nullptr;
+    }
+    else
+    {
+        final_nxny = getCenterOfChildren(gc, step1_nxny, step1_nxcy, step1_cxny, step1_cxcy);
+        StepControl::subproblemDone(control, level, final_nxny);
+        final_nxpy = getCenterOfChildren(gc, step1_nxcy, step1_nxpy, step1_cxcy, step1_cxpy);
+        StepControl::subproblemDone(control, level, final_nxpy);
+        final_pxny = getCenterOfChildren(gc, step1_cxny, step1_cxcy, step1_pxny, step1_pxcy);
+        StepControl::subproblemDone(control, level, final_pxny);
+        final_pxpy = getCenterOfChildren(gc, step1_cxcy, step1_cxpy, step1_pxcy, step1_pxpy);
+        StepControl::subproblemDone(control, level, final_pxpy);
+    }
+    return gc->findOrInsertNonleaf(final_nxny, final_nxpy, final_pxny, final_pxpy);
+}
+
+// most of the overlapping nodes the recursion builds are only ever used once, so instead of putting them in the table
+// (hashing, locking, allocating and counting them towards the next gc) their next states are looked up by their children :
+// in the node with those children if it's in the table anyway, otherwise in the table's transient cache
+NodeReference getNextStateOfChildren(NodeGCHashTable *gc, const Rule *rule, const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy, size_t logStepSize, StepControl *control)
+{
+    NodeReference retval = gc->findChildrenNextState(nxny, nxpy, pxny, pxpy, rule, logStepSize);
+    if(retval != nullptr)
+    {
+        gc->countMemoHit();
+        return retval;
+    }
+    NodeReference node = gc->findNonleaf(nxny, nxpy, pxny, pxpy);
+    if(node != nullptr)
+        return node->getNextState(gc, rule, logStepSize, control);
+    gc->countMemoMiss();
+    retval = computeNextState(gc, rule, nxny, nxpy, pxny, pxpy, logStepSize, control);
+    if(retval != nullptr)
+        gc->setChildrenNextState(nxny, nxpy, pxny, pxpy, rule, logStepSize, retval);
+    return retval;
+}
+}
+
+NodeReference NodeType::getNextState(NodeGCHashTable *gc, const Rule *rule, StepControl *control) const
+{
+    assert(level > 0);
+    return getNextState(gc, rule, level - 1, control);
+}
+
+NodeReference NodeType::getNextState(NodeGCHashTable *gc, const Rule *rule, size_t logStepSize, StepControl *control) const
+{
+    NodeReference thisRef = this;
+    assert(level >= logStepSize + 1);
+    size_t retvalLogStepSize;
+    NodeReference retval = getNextStateMemo(rule, retvalLogStepSize);
+    if(retval != nullptr && retvalLogStepSize == logStepSize)
+    {
+        gc->countMemoHit();
+        return retval;
+    }
+    gc->countMemoMiss();
+    retval = computeNextState(gc, rule, nxny.nonleaf, nxpy.nonleaf, pxny.nonleaf, pxpy.nonleaf, logStepSize, control);
+    if(retval == nullptr)
+        return nullptr;
+    setNextStateMemo(retval, rule, logStepSize);
+    return retval;
+}
+
+constexpr int maxDrawNodeLogSize = 61; // keeps x + (1 << logSize) from overflowing for any visible x
+
+void drawNode(NodeReference node, int64_t x, int64_t y, int logSize, void *pixels, int w, int h, int pitch, RenderTileCache *cache)
+{
+    assert(logSize <= maxDrawNodeLogSize);
+    if(logSize <= 0)
+    {
+        drawPixel(x, y, getCellColorDescriptorColor(node->getOverallCellColorDescriptor()), pixels, w, h, pitch);
+        return;
+    }
+    int64_t size = (int64_t)1 << logSize;
+    if(x >= w || y >= h || x + size <= 0 || y + size <= 0)
+        return;
+    if(cache != nullptr && logSize >= RenderTileCache::minTileLogSize && logSize <= RenderTileCache::maxTileLogSize
+            && x >= 0 && y >= 0 && x + size <= w && y + size <= h)
+    {
+        cache->draw(node, logSize, (int)x, (int)y, pixels, pitch);
+        return;
+    }
+    int64_t halfSize = size / 2;
+    if(node->level == 0)
+    {
+        drawSquare(x, y, halfSize, getCellColorDescriptorColor(getCellColorDescriptor(node->nxny.leaf)), pixels, w, h, pitch);
+        drawSquare(x, y + halfSize, halfSize, getCellColorDescriptorColor(getCellColorDescriptor(node->nxpy.leaf)), pixels, w, h, pitch);
+        drawSquare(x + halfSize, y, halfSize, getCellColorDescriptorColor(getCellColorDescriptor(node->pxny.leaf)), pixels, w, h, pitch);
+        drawSquare(x + halfSize, y + halfSize, halfSize, getCellColorDescriptorColor(getCellColorDescriptor(node->pxpy.leaf)), pixels, w, h, pitch);
+        return;
+    }
+    drawNode(node->nxny.nonleaf, x, y, logSize - 1, pixels, w, h, pitch, cache);
+    drawNode(node->nxpy.nonleaf, x, y + halfSize, logSize - 1, pixels, w, h, pitch, cache);
+    drawNode(node->pxny.nonleaf, x + halfSize, y, logSize - 1, pixels, w, h, pitch, cache);
+    drawNode(node->pxpy.nonleaf, x + halfSize, y + halfSize, logSize - 1, pixels, w, h, pitch, cache);
+}
+
+inline void drawQuadrant(bool left, bool top, int64_t cornerX, int64_t cornerY, Color color, void *pixels, int w, int h, int pitch)
+{
+    int clippedX = (int)max<int64_t>(0, min<int64_t>(cornerX, w));
+    int clippedY = (int)max<int64_t>(0, min<int64_t>(cornerY, h));
+    int startX = left ? 0 : clippedX, endX = left ? clippedX : w;
+    int startY = top ? 0 : clippedY, endY = top ? clippedY : h;
+    drawRectangle(startX, startY, endX - startX, endY - startY, color, pixels, w, h, pitch);
+}
+
+// draws a node too big for drawNode that lies to the left or right and above or below the corner point;
+// only the child touching the corner can reach the buffer
+void drawCornerNode(const NodeType *node, bool left, bool top, int64_t cornerX, int64_t cornerY, int logSize, void *pixels, int w, int h, int pitch, RenderTileCache *cache)
+{
+    if(logSize <= maxDrawNodeLogSize)
+    {
+        int64_t size = (int64_t)1 << logSize;
+        drawNode(node, left ? cornerX - size : cornerX, top ? cornerY - size : cornerY, logSize, pixels, w, h, pitch, cache);
+        return;
+    }
+    if(node->level == 0)
+    {
+        CellType cell = left ? (top ? node->pxpy.leaf : node->pxny.leaf) : (top ? node->nxpy.leaf : node->nxny.leaf);
+        drawQuadrant(left, top, cornerX, cornerY, getCellColorDescriptorColor(getCellColorDescriptor(cell)), pixels, w, h, pitch);
+        return;
+    }
+    const NodeType *child = left ? (top ? node->pxpy.nonleaf : node->pxny.nonleaf) : (top ? node->nxpy.nonleaf : node->nxny.nonleaf);
+    drawCornerNode(child, left, top, cornerX, cornerY, logSize - 1, pixels, w, h, pitch, cache);
+}
+
+void drawCenteredNode(NodeReference node, int64_t centerX, int64_t centerY, int logSize, void *pixels, int w, int h, int pitch, RenderTileCache *cache)
+{
+    if(logSize <= maxDrawNodeLogSize)
+    {
+        int64_t halfSize = (logSize > 0 ? (int64_t)1 << (logSize - 1) : 0);
+        drawNode(node, centerX - halfSize, centerY - halfSize, logSize, pixels, w, h, pitch, cache);
+        return;
+    }
+    if(node->level == 0)
+    {
+        drawQuadrant(true, true, centerX, centerY, getCellColorDescriptorColor(getCellColorDescriptor(node->nxny.leaf)), pixels, w, h, pitch);
+        drawQuadrant(true, false, centerX, centerY, getCellColorDescriptorColor(getCellColorDescriptor(node->nxpy.leaf)), pixels, w, h, pitch);
+        drawQuadrant(false, true, centerX, centerY, getCellColorDescriptorColor(getCellColorDescriptor(node->pxny.leaf)), pixels, w, h, pitch);
+        drawQuadrant(false, false, centerX, centerY, getCellColorDescriptorColor(getCellColorDescriptor(node->pxpy.leaf)), pixels, w, h, pitch);
+        return;
+    }
+    drawCornerNode(node->nxny.nonleaf, true, true, centerX, centerY, logSize - 1, pixels, w, h, pitch, cache);
+    drawCornerNode(node->nxpy.nonleaf, true, false, centerX, centerY, logSize - 1, pixels, w, h, pitch, cache);
+    drawCornerNode(node->pxny.nonleaf, false, true, centerX, centerY, logSize - 1, pixels, w, h, pitch, cache);
+    drawCornerNode(node->pxpy.nonleaf, false, false, centerX, centerY, logSize - 1, pixels, w, h, pitch, cache);
+}
+
+shared_ptr<const vector<Color>> RenderTileCache::get(const NodeType * node, int logSize)
+{
+    Key key{node, logSize};
+    {
+        lock_guard<std::mutex> lockIt(theLock);
+        auto iter = entryMap.find(key);
+        if(iter != entryMap.end())
+        {
+            if(iter->second->node.get() == node)
+            {
+                entries.splice(entries.begin(), entries, iter->second);
+                return entries.front().pixels;
+            }
+            pixelCount -= iter->second->pixels->size();
+            entries.erase(iter->second);
+            entryMap.erase(iter);
+        }
+    }
+    int size = 1 << logSize;
+    auto pixels = make_shared<vector<Color>>((size_t)size * size);
+    void *buffer = (void *)pixels->data();
+    int pitch = size * sizeof(Color);
+    if(node->level == 0)
+    {
+        drawNode(node, 0, 0, logSize, buffer, size, size, pitch);
+    }
+    else
+    {
+        int halfSize = size / 2;
+        drawNode(node->nxny.nonleaf, 0, 0, logSize - 1, buffer, size, size, pitch, this);
+        drawNode(node->nxpy.nonleaf, 0, halfSize, logSize - 1, buffer, size, size, pitch, this);
+        drawNode(node->pxny.nonleaf, halfSize, 0, logSize - 1, buffer, size, size, pitch, this);
+        drawNode(node->pxpy.nonleaf, halfSize, halfSize, logSize - 1, buffer, size, size, pitch, this);
+    }
+    lock_guard<std::mutex> lockIt(theLock);
+    if(entryMap.count(key) != 0) // another thread rendered it first
+        return pixels;
+    while(!entries.empty() && pixelCount + pixels->size() > maxPixelCount)
+    {
+        pixelCount -= entries.back().pixels->size();
+        entryMap.erase(entries.back().key);
+        entries.pop_back();
+    }
+    entries.emplace_front();
+    Entry & entry = entries.front();
+    entry.key = key;
+    entry.node = node;
+    entry.pixels = pixels;
+    pixelCount += pixels->size();
+    entryMap[key] = entries.begin();
+    return pixels;
+}
+
+NodeReference setCellH(NodeReference node, NodeGCHashTable * gc, uint64_t x, uint64_t y, CellType newCell)
+{
+    assert(node->level < 64);
+    if(node->level == 0)
+    {
+        CellType nxny = node->nxny.leaf;
+        CellType nxpy = node->nxpy.leaf;
+        CellType pxny = node->pxny.leaf;
+        CellType pxpy = node->pxpy.leaf;
+        if(!(x & 1) && !(y & 1))
+            nxny = newCell;
+        else if(!(x & 1))
+            nxpy = newCell;
+        else if(!(y & 1))
+            pxny = newCell;
+        else
+            pxpy = newCell;
+        return gc->findOrInsertLeaf(nxny, nxpy, pxny, pxpy);
+    }
+    NodeReference nxny = node->nxny.nonleaf;
+    NodeReference nxpy = node->nxpy.nonleaf;
+    NodeReference pxny = node->pxny.nonleaf;
+    NodeReference pxpy = node->pxpy.nonleaf;
+    bool isPX = (x >> node->level) & 1, isPY = (y >> node->level) & 1;
+    if(!isPX)
+    {
+        if(!isPY)
+            nxny = setCellH(nxny, gc, x, y, newCell);
+        else
+            nxpy = setCellH(nxpy, gc, x, y, newCell);
+    }
+    else
+    {
+        if(!isPY)
+            pxny = setCellH(pxny, gc, x, y, newCell);
+        else
+            pxpy = setCellH(pxpy, gc, x, y, newCell);
+    }
+    return gc->findOrInsertNonleaf(nxny, nxpy, pxny, pxpy);
+}
+
+NodeReference setCellH(NodeReference node, NodeGCHashTable * gc, const BigUnsigned & x, const BigUnsigned & y, CellType newCell)
+{
+    if(node->level < 64)
+        return setCellH(node, gc, x.toUInt64(), y.toUInt64(), newCell);
+    NodeReference nxny = node->nxny.nonleaf;
+    NodeReference nxpy = node->nxpy.nonleaf;
+    NodeReference pxny = node->pxny.nonleaf;
+    NodeReference pxpy = node->pxpy.nonleaf;
+    bool isPX = x.getBit(node->level), isPY = y.getBit(node->level);
+    if(!isPX)
+    {
+        if(!isPY)
+            nxny = setCellH(nxny, gc, x, y, newCell);
+        else
+            nxpy = setCellH(nxpy, gc, x, y, newCell);
+    }
+    else
+    {
+        if(!isPY)
+            pxny = setCellH(pxny, gc, x, y, newCell);
+        else
+            pxpy = setCellH(pxpy, gc, x, y, newCell);
+    }
+    return gc->findOrInsertNonleaf(nxny, nxpy, pxny, pxpy);
+}
+
+bool isInNodeBounds(NodeReference node, int64_t x, int64_t y)
+{
+    if(node->level >= 63)
+        return true;
+    int64_t subNodeSize = (int64_t)1 << node->level;
+    if(x < -subNodeSize || x >= subNodeSize || y < -subNodeSize || y >= subNodeSize)
+        return false;
+    return true;
+}
+
+bool isInNodeBounds(NodeReference node, const BigInteger & x, const BigInteger & y)
+{
+    BigInteger subNodeSize = BigInteger(BigUnsigned(1) << node->level);
+    if(x < -subNodeSize || x >= subNodeSize || y < -subNodeSize || y >= subNodeSize)
+        return false;
+    return true;
+}
+
+CellType getCellH(NodeReference node, uint64_t x, uint64_t y)
+{
+    assert(node->level < 64);
+    const NodeType * currentNode = node;
+    while(currentNode->level > 0)
+    {
+        bool isPX = (x >> currentNode->level) & 1, isPY = (y >> currentNode->level) & 1;
+        if(!isPX)
+            currentNode = isPY ? currentNode->nxpy.nonleaf : currentNode->nxny.nonleaf;
+        else
+            currentNode = isPY ? currentNode->pxpy.nonleaf : currentNode->pxny.nonleaf;
+    }
+    if(!(x & 1))
+        return (y & 1) ? currentNode->nxpy.leaf : currentNode->nxny.leaf;
+    return (y & 1) ? currentNode->pxpy.leaf : currentNode->pxny.leaf;
+}
+
+CellType getCellH(NodeReference node, const BigUnsigned & x, const BigUnsigned & y)
+{
+    const NodeType * currentNode = node;
+    while(currentNode->level >= 64)
+    {
+        bool isPX = x.getBit(currentNode->level), isPY = y.getBit(currentNode->level);
+        if(!isPX)
+            currentNode = isPY ? currentNode->nxpy.nonleaf : currentNode->nxny.nonleaf;
+        else
+            currentNode = isPY ? currentNode->pxpy.nonleaf : currentNode->pxny.nonleaf;
+    }
+    return getCellH(currentNode, x.toUInt64(), y.toUInt64());
+}
+
+namespace
+{
+BigUnsigned getBigPopulation(const NodeType * node, CellType backgroundType, unordered_map<const NodeType *, BigUnsigned> & memo)
+{
+    uint64_t population = node->getPopulation(backgroundType);
+    if(population != NodeType::populationTooBig)
+        return BigUnsigned(population);
+    auto iter = memo.find(node);
+    if(iter != memo.end())
+        return iter->second;
+    BigUnsigned retval = getBigPopulation(node->nxny.nonleaf, backgroundType, memo);
+    retval += getBigPopulation(node->nxpy.nonleaf, backgroundType, memo);
+    retval += getBigPopulation(node->pxny.nonleaf, backgroundType, memo);
+    retval += getBigPopulation(node->pxpy.nonleaf, backgroundType, memo);
+    memo[node] = retval;
+    return retval;
+}
+
+void addCellCounts(map<CellType, BigUnsigned> & counts, const map<CellType, BigUnsigned> & addedCounts)
+{
+    for(const pair<const CellType, BigUnsigned> & count : addedCounts)
+        counts[count.first] += count.second;
+}
+
+const map<CellType, BigUnsigned> & getCellCounts(const NodeType * node, unordered_map<const NodeType *, map<CellType, BigUnsigned>> & memo)
+{
+    auto iter = memo.find(node);
+    if(iter != memo.end())
+        return iter->second;
+    map<CellType, BigUnsigned> retval;
+    if(node->level == 0)
+    {
+        for(CellType cell : {node->nxny.leaf, node->nxpy.leaf, node->pxny.leaf, node->pxpy.leaf})
+            retval[cell] += BigUnsigned(1);
+    }
+    else
+    {
+        for(const NodeType * child : {node->nxny.nonleaf, node->nxpy.nonleaf, node->pxny.nonleaf, node->pxpy.nonleaf})
+            addCellCounts(retval, getCellCounts(child, memo));
+    }
+    return memo[node] = std::move(retval);
+}
+}
+
+BigUnsigned getPopulation(NodeReference node, CellType backgroundType)
+{
+    if(backgroundType > 1) // only read from files, never made by stepping, so not worth caching
+    {
+        BigUnsigned retval;
+        for(const pair<const CellType, BigUnsigned> & count : getCellCounts(node))
+        {
+            if(count.first != backgroundType)
+                retval += count.second;
+        }
+        return retval;
+    }
+    unordered_map<const NodeType *, BigUnsigned> memo;
+    return getBigPopulation(node, backgroundType, memo);
+}
+
+map<CellType, BigUnsigned> getCellCounts(NodeReference node)
+{
+    unordered_map<const NodeType *, map<CellType, BigUnsigned>> memo;
+    return getCellCounts(node, memo);
+}
+
+NodeReference getWindowNode(NodeGCHashTable * gc, const NodeType * nxny, const NodeType * nxpy, const NodeType * pxny, const NodeType * pxpy, uint64_t x, uint64_t y, WindowMemo & memo)
+{
+    size_t level = nxny->level;
+    uint64_t size = (uint64_t)2 << level;
+    assert(level <= maxBiasedNodeLevel && x <= size && y <= size);
+    if(x == 0 && y == 0)
+        return nxny;
+    if(x == 0 && y == size)
+        return nxpy;
+    if(x == size && y == 0)
+        return pxny;
+    if(x == size && y == size)
+        return pxpy;
+    if(nxny->getPopulation() == 0 && nxpy->getPopulation() == 0 && pxny->getPopulation() == 0 && pxpy->getPopulation() == 0)
+        return nxny;
+    WindowKey key{nxny, nxpy, pxny, pxpy, x, y};
+    auto iter = memo.find(key);
+    if(iter != memo.end())
+        return iter->second;
+    NodeReference retval;
+    if(level == 0)
+    {
+        auto getCell = [&](uint64_t cellX, uint64_t cellY)
+        {
+            const NodeType * leaf = cellY < 2 ? (cellX < 2 ? nxny : pxny) : (cellX < 2 ? nxpy : pxpy);
+            bool isPX = cellX & 1, isPY = cellY & 1;
+            return isPX ? (isPY ? leaf->pxpy.leaf : leaf->pxny.leaf) : (isPY ? leaf->nxpy.leaf : leaf->nxny.leaf);
+        };
+        retval = gc->findOrInsertLeaf(getCell(x, y), getCell(x, y + 1), getCell(x + 1, y), getCell(x + 1, y + 1));
+    }
+    else
+    {
+        // the grid of grandchildren, indexed by row then column
+        const NodeType * grid[4][4] =
+        {
+            {nxny->nxny.nonleaf, nxny->pxny.nonleaf, pxny->nxny.nonleaf, pxny->pxny.nonleaf},
+            {nxny->nxpy.nonleaf, nxny->pxpy.nonleaf, pxny->nxpy.nonleaf, pxny->pxpy.nonleaf},
+            {nxpy->nxny.nonleaf, nxpy->pxny.nonleaf, pxpy->nxny.nonleaf, pxpy->pxny.nonleaf},
+            {nxpy->nxpy.nonleaf, nxpy->pxpy.nonleaf, pxpy->nxpy.nonleaf, pxpy->pxpy.nonleaf},
+        };
+        uint64_t halfSize = (uint64_t)1 << level;
+        NodeReference quadrants[2][2];
+        for(int quadrantY = 0; quadrantY < 2; quadrantY++)
+        {
+            for(int quadrantX = 0; quadrantX < 2; quadrantX++)
+            {
+                uint64_t quadrantLeft = x + quadrantX * halfSize, quadrantTop = y + quadrantY * halfSize;
+                size_t column = (size_t)min<uint64_t>(quadrantLeft / halfSize, 2), row = (size_t)min<uint64_t>(quadrantTop / halfSize, 2);
+                quadrants[quadrantY][quadrantX] = getWindowNode(gc, grid[row][column], grid[row + 1][column], grid[row][column + 1], grid[row + 1][column + 1],
+                                                                quadrantLeft - column * halfSize, quadrantTop - row * halfSize, memo);
+            }
+        }
+        retval = gc->findOrInsertNonleaf(quadrants[0][0], quadrants[1][0], quadrants[0][1], quadrants[1][1]);
+    }
+    memo[key] = retval;
+    return retval;
+}
+
+NodeReference setNodeH(NodeReference node, NodeGCHashTable * gc, const BigUnsigned & x, const BigUnsigned & y, NodeReference newNode)
+{
+    assert(node->level >= newNode->level);
+    if(node->level == newNode->level)
+        return newNode;
+    NodeReference nxny = node->nxny.nonleaf;
+    NodeReference nxpy = node->nxpy.nonleaf;
+    NodeReference pxny = node->pxny.nonleaf;
+    NodeReference pxpy = node->pxpy.nonleaf;
+    bool isPX = x.getBit(node->level), isPY = y.getBit(node->level);
+    if(!isPX)
+    {
+        if(!isPY)
+            nxny = setNodeH(nxny, gc, x, y, newNode);
+        else
+            nxpy = setNodeH(nxpy, gc, x, y, newNode);
+    }
+    else
+    {
+        if(!isPY)
+            pxny = setNodeH(pxny, gc, x, y, newNode);
+        else
+            pxpy = setNodeH(pxpy, gc, x, y, newNode);
+    }
+    return gc->findOrInsertNonleaf(nxny, nxpy, pxny, pxpy);
+}
+
+namespace
+{
+// calls fn(oldNode, newNode, nodeX, nodeY) for the pairs of differing nodes of level stopLevel, in Morton (Z) order
+template <typename Fn>
+void visitChangedNodesH(const NodeType * oldNode, const NodeType * newNode, uint64_t nodeX, uint64_t nodeY, size_t stopLevel, Fn & fn)
+{
+    if(oldNode == newNode)
+        return;
+    if(oldNode->level == stopLevel)
+    {
+        fn(oldNode, newNode, nodeX, nodeY);
+        return;
+    }
+    uint64_t halfSize = (uint64_t)1 << oldNode->level;
+    visitChangedNodesH(oldNode->nxny.nonleaf, newNode->nxny.nonleaf, nodeX, nodeY, stopLevel, fn);
+    visitChangedNodesH(oldNode->pxny.nonleaf, newNode->pxny.nonleaf, nodeX + halfSize, nodeY, stopLevel, fn);
+    visitChangedNodesH(oldNode->nxpy.nonleaf, newNode->nxpy.nonleaf, nodeX, nodeY + halfSize, stopLevel, fn);
+    visitChangedNodesH(oldNode->pxpy.nonleaf, newNode->pxpy.nonleaf, nodeX + halfSize, nodeY + halfSize, stopLevel, fn);
+}
+
+// both roots at the same level, at least minLevel, with the biased coordinate of their top left corner
+bool getDiffRoots(const GameState & oldState, const GameState & newState, size_t minLevel, NodeReference & oldRoot, NodeReference & newRoot, uint64_t & rootCorner)
+{
+    assert(oldState && newState && oldState.gc == newState.gc);
+    if(oldState.backgroundType != newState.backgroundType)
+        return false;
+    size_t level = max(minLevel, max(oldState.rootNode->level, newState.rootNode->level));
+    if(level > maxBiasedNodeLevel)
+        return false;
+    oldRoot = oldState.getExpandedRootNode(level);
+    newRoot = newState.getExpandedRootNode(level);
+    rootCorner = coordinateBias - ((uint64_t)1 << level);
+    return true;
+}
+}
+
+bool diffStates(const GameState & oldState, const GameState & newState, vector<ChangedCell> & changedCells)
+{
+    NodeReference oldRoot, newRoot;
+    uint64_t rootCorner;
+    if(!getDiffRoots(oldState, newState, 0, oldRoot, newRoot, rootCorner))
+        return false;
+    auto fn = [&](const NodeType * oldNode, const NodeType * newNode, uint64_t nodeX, uint64_t nodeY)
+    {
+        const CellType oldCells[4] = {oldNode->nxny.leaf, oldNode->pxny.leaf, oldNode->nxpy.leaf, oldNode->pxpy.leaf};
+        const CellType newCells[4] = {newNode->nxny.leaf, newNode->pxny.leaf, newNode->nxpy.leaf, newNode->pxpy.leaf};
+        for(size_t i = 0; i < 4; i++)
+        {
+            if(oldCells[i] != newCells[i])
+                changedCells.push_back(ChangedCell{(int64_t)(nodeX + i % 2 - coordinateBias), (int64_t)(nodeY + i / 2 - coordinateBias), oldCells[i], newCells[i]});
+        }
+    };
+    visitChangedNodesH(oldRoot, newRoot, rootCorner, rootCorner, 0, fn);
+    return true;
+}
+
+bool diffStates(const GameState & oldState, const GameState & newState, size_t logSize, vector<ChangedSquare> & changedSquares)
+{
+    if(logSize == 0)
+    {
+        vector<ChangedCell> changedCells;
+        if(!diffStates(oldState, newState, changedCells))
+            return false;
+        for(const ChangedCell & changedCell : changedCells)
+            changedSquares.push_back(ChangedSquare{changedCell.x, changedCell.y, 1});
+        return true;
+    }
+    // the roots are at least twice the size of the squares, so the squares' nodes are exactly 2^logSize and, since
+    // the roots are centered on the origin, aligned to their size
+    NodeReference oldRoot, newRoot;
+    uint64_t rootCorner;
+    if(!getDiffRoots(oldState, newState, logSize, oldRoot, newRoot, rootCorner))
+        return false;
+    size_t stopLevel = logSize - 1;
+    auto fn = [&](const NodeType *, const NodeType *, uint64_t nodeX, uint64_t nodeY)
+    {
+        changedSquares.push_back(ChangedSquare{(int64_t)(nodeX - coordinateBias), (int64_t)(nodeY - coordinateBias), (uint64_t)2 << stopLevel});
+    };
+    visitChangedNodesH(oldRoot, newRoot, rootCorner, rootCorner, stopLevel, fn);
+    return true;
+}
+
+string getCellStringNoPrefix(CellType cellType)
+{
+    if(cellType)
+        return "#";
+    return "-";
+}
+
+string getCellString(CellType cellType)
+{
+    return "C" + getCellStringNoPrefix(cellType);
+}
+
+string getNodeString(int nodeIndex)
+{
+    ostringstream os;
+    os << "N" << nodeIndex;
+    return os.str();
+}
+
+vector<vector<CellType>> getNodeGraph(NodeReference node)
+{
+    if(node->level == 0)
+    {
+        return vector<vector<CellType>>{vector<CellType>{node->nxny.leaf, node->pxny.leaf}, vector<CellType>{node->nxpy.leaf, node->pxpy.leaf}};
+    }
+    vector<vector<CellType>> nxny = getNodeGraph(node->nxny.nonleaf);
+    vector<vector<CellType>> nxpy = getNodeGraph(node->nxpy.nonleaf);
+    vector<vector<CellType>> pxny = getNodeGraph(node->pxny.nonleaf);
+    vector<vector<CellType>> pxpy = getNodeGraph(node->pxpy.nonleaf);
+    vector<vector<CellType>> retval;
+    size_t subNodeSize = (size_t)1 << node->level;
+    retval.reserve(2 * subNodeSize);
+    for(size_t y = 0; y < subNodeSize; y++)
+    {
+        retval.push_back(std::move(nxny[y]));
+        retval.back().reserve(2 * subNodeSize);
+        retval.back().insert(retval.back().end(), pxny[y].begin(), pxny[y].end());
+    }
+    for(size_t y = 0; y < subNodeSize; y++)
+    {
+        retval.push_back(std::move(nxpy[y]));
+        retval.back().reserve(2 * subNodeSize);
+        retval.back().insert(retval.back().end(), pxpy[y].begin(), pxpy[y].end());
+    }
+    return std::move(retval);
+}
+
+string getNodeGraphAsString(NodeReference node)
+{
+    vector<vector<CellType>> theGraph = getNodeGraph(node);
+    ostringstream os;
+    for(const vector<CellType> & line : theGraph)
+    {
+        string seperator = "";
+        for(CellType cell : line)
+        {
+            string cellString = getCellStringNoPrefix(cell);
+            cellString.resize(2, ' ');
+            os << seperator << cellString;
+            seperator = " ";
+        }
+        os << "\n";
+    }
+    return os.str();
+}
+
+void dump(NodeReference rootNode)
+{
+    unordered_map<NodeReference, int> nodesMap;
+    int nextNodeIndex = 1;
+    vector<NodeReference> nodesList;
+    unordered_set<NodeReference> newNodesSet;
+    newNodesSet.insert(rootNode);
+    while(!newNodesSet.empty())
+    {
+        unordered_set<NodeReference> nodesSet(std::move(newNodesSet));
+        newNodesSet.clear();
+        for(NodeReference node : nodesSet)
+        {
+            if(nodesMap.count(node) == 0)
+            {
+                nodesMap[node] = nextNodeIndex++;
+                nodesList.push_back(node);
+                if(node->level > 0)
+                {
+                    newNodesSet.insert(node->nxny.nonleaf);
+                    newNodesSet.insert(node->nxpy.nonleaf);
+                    newNodesSet.insert(node->pxny.nonleaf);
+                    newNodesSet.insert(node->pxpy.nonleaf);
+                }
+            }
+        }
+    }
+    std::reverse(nodesList.begin(), nodesList.end());
+    for(NodeReference node : nodesList)
+    {
+        string nodeName = getNodeString(nodesMap[node]);
+        nodeName.resize(10, ' ');
+        cout << nodeName << " : " << node->level << "\n    ";
+        string nxny, nxpy, pxny, pxpy;
+        if(node->level == 0)
+        {
+            nxny = getCellString(node->nxny.leaf);
+            nxpy = getCellString(node->nxpy.leaf);
+            pxny = getCellString(node->pxny.leaf);
+            pxpy = getCellString(node->pxpy.leaf);
+        }
+        else
+        {
+            nxny = getNodeString(nodesMap[node->nxny.nonleaf]);
+            nxpy = getNodeString(nodesMap[node->nxpy.nonleaf]);
+            pxny = getNodeString(nodesMap[node->pxny.nonleaf]);
+            pxpy = getNodeString(nodesMap[node->pxpy.nonleaf]);
+        }
+        nxny.resize(10, ' ');
+        nxpy.resize(10, ' ');
+        pxny.resize(10, ' ');
+        pxpy.resize(10, ' ');
+        cout << nxny << " " << pxny << "\n    " << nxpy << " " << pxpy << "\n";
+        if(node->level <= 3)
+        {
+            cout << "\n" << getNodeGraphAsString(node);
+        }
+        cout << "\n";
+    }
+    cout << flush;
+}
+
+GameState readRLE(istream & is, NodeGCHashTable * gc, ostream & progress)
+{
+    progress << "reading ...\x1b[K\r" << flush;
+    GameState retval = GameState(gc);
+    char xch, eq1, comma, ych, eq2, comma2, eq3;
+    int64_t w, h;
+    string rule, ruleName;
+    int64_t originX = 0, originY = 0;
+    while(is.peek() == '#')
+    {
+        string line;
+        getline(is, line);
+        size_t posIndex = line.find("Pos=");
+        if(line.compare(0, 6, "#CXRLE") == 0 && posIndex != string::npos)
+        {
+            istringstream posStream(line.substr(posIndex + 4));
+            char posComma;
+            if(!(posStream >> originX >> posComma >> originY) || posComma != ',')
+            {
+                progress << "read failed.\x1b[K\n" << flush;
+                return nullptr;
+            }
+        }
+    }
+    is >> xch >> eq1 >> w >> comma >> ych >> eq2 >> h >> comma2 >> ruleName >> eq3 >> rule;
+    is.ignore(10000, '\n');
+    // every run is checked against the size in the header, so bad counts can't overflow the coordinates or run on
+    // far past the pattern; the header is checked so that every cell in it has 64-bit coordinates
+    const int64_t maxCoordinate = (int64_t)(coordinateBias - 1);
+    if(!is || w < 0 || h < 0 || (w > 0 && originX > maxCoordinate - (w - 1)) || (h > 0 && originY > maxCoordinate - (h - 1)))
+    {
+        progress << "read failed.\x1b[K\n" << flush;
+        return nullptr;
+    }
+    retval.rule = Rule::parse(rule);
+    if(retval.rule == nullptr)
+    {
+        progress << "read failed.\x1b[K\n" << flush;
+        return nullptr;
+    }
+    uint64_t column = 0, row = 0, currentCount = 0, popCount = 0;
+    auto getRunLength = [&]() -> uint64_t
+    {
+        uint64_t retval = (currentCount == 0 ? 1 : currentCount);
+        currentCount = 0;
+        return retval;
+    };
+    auto setCells = [&](CellType cell) -> bool
+    {
+        uint64_t runLength = getRunLength();
+        if(row >= (uint64_t)h || runLength > (uint64_t)w - column)
+            return false;
+        for(uint64_t i = 0; i < runLength; i++, column++)
+        {
+            retval.setCell(originX + (int64_t)column, originY + (int64_t)row, cell);
+            if(++popCount % 1000 == 0)
+                progress << "reading ... " << popCount << "\x1b[K\r" << flush;
+        }
+        return true;
+    };
+    while(is)
+    {
+        int ch = is.get();
+        bool valid = true;
+        if(ch >= '0' && ch <= '9')
+        {
+            if(currentCount > (uint64_t)max(w, h) / 10)
+                valid = false;
+            else
+                currentCount = currentCount * 10 + (uint64_t)(ch - '0');
+        }
+        else if(ch == 'b' || ch == '.')
+        {
+            uint64_t runLength = getRunLength();
+            if(runLength > (uint64_t)w - column)
+                valid = false;
+            else
+                column += runLength;
+        }
+        else if(ch == 'o')
+        {
+            valid = setCells(1);
+        }
+        else if(ch >= 'A' && ch <= 'X')
+        {
+            valid = setCells(1 + (int)ch - 'A');
+        }
+        else if(ch == 'p')
+        {
+            ch = is.get();
+            valid = (ch >= 'A' && ch <= 'X' && setCells(25 + (int)ch - 'A'));
+        }
+        else if(ch >= 'q' && ch < 'y')
+        {
+            char oldCh = ch;
+            ch = is.get();
+            valid = (ch >= 'A' && ch <= 'Z' && setCells(49 + 26 * (int)(oldCh - 'q') + (int)ch - 'A'));
+        }
+        else if(ch == 'y')
+        {
+            ch = is.get();
+            valid = (ch >= 'A' && ch <= 'O' && setCells(241 + (int)ch - 'A'));
+        }
+        else if(ch == '$')
+        {
+            uint64_t runLength = getRunLength();
+            if(runLength > (uint64_t)h - row)
+                valid = false;
+            else
+            {
+                column = 0;
+                row += runLength;
+            }
+        }
+        else if(ch == '!')
+        {
+            progress << "read.\x1b[K\n" << flush;
+            return retval;
+        }
+        else if(ch == ' ' || ch == '\r' || ch == '\n' || ch == '\t')
+        {
+        }
+        else
+        {
+            valid = false;
+        }
+        if(!valid)
+        {
+            progress << "read failed.\x1b[K\n" << flush;
+            return nullptr;
+        }
+    }
+    progress << "read failed.\x1b[K\n" << flush;
+    return nullptr;
+}
+
+string getRLECellCode(CellType cellType)
+{
+    if(cellType == 0)
+        return "b";
+    if(cellType == 1)
+        return "o";
+    assert(cellType <= 255);
+    if(cellType <= 24)
+        return string(1, (char)('A' + cellType - 1));
+    if(cellType <= 48)
+        return string("p") + (char)('A' + cellType - 25);
+    return string(1, (char)('q' + (cellType - 49) / 26)) + (char)('A' + (cellType - 49) % 26);
+}
+
+// incremental run-length encoder; cells must be written in row order
+class RLEWriter
+{
+    RLEWriter(const RLEWriter &) = delete;
+    const RLEWriter &operator =(const RLEWriter &) = delete;
+private:
+    static constexpr size_t maxLineLength = 70;
+    ostream & os;
+    const uint64_t width;
+    const CellType backgroundType;
+    size_t lineLength = 0;
+    uint64_t x = 0, y = 0;
+    CellType runCell = 0;
+    uint64_t runLength = 0;
+    uint64_t pendingRowCount = 0;
+    void writeItem(uint64_t count, string code)
+    {
+        ostringstream ss;
+        if(count > 1)
+            ss << count;
+        ss << code;
+        string item = ss.str();
+        if(lineLength + item.size() > maxLineLength)
+        {
+            os << "\n";
+            lineLength = 0;
+        }
+        os << item;
+        lineLength += item.size();
+    }
+    void flushRun()
+    {
+        if(runLength == 0)
+            return;
+        if(pendingRowCount > 0)
+        {
+            writeItem(pendingRowCount, "$");
+            pendingRowCount = 0;
+        }
+        writeItem(runLength, getRLECellCode(runCell));
+        runLength = 0;
+    }
+    void writeRun(CellType cell, uint64_t count)
+    {
+        if(count == 0)
+            return;
+        if(runLength > 0 && runCell != cell)
+            flushRun();
+        runCell = cell;
+        runLength += count;
+        x += count;
+    }
+    void endRow()
+    {
+        if(x < width && backgroundType != 0)
+            writeRun(backgroundType, width - x);
+        if(runCell != 0)
+            flushRun();
+        runLength = 0;
+        pendingRowCount++;
+        x = 0;
+        y++;
+    }
+public:
+    RLEWriter(ostream & os, uint64_t width, uint64_t height, int64_t originX, int64_t originY, string rule, CellType backgroundType)
+        : os(os), width(width), backgroundType(backgroundType)
+    {
+        os << "#CXRLE Pos=" << originX << "," << originY << "\n";
+        os << "x = " << width << ", y = " << height << ", rule = " << rule << "\n";
+    }
+    void writeCell(uint64_t cellX, uint64_t cellY, CellType cell) // relative to the origin
+    {
+        assert(cellY > y || (cellY == y && cellX >= x));
+        while(y < cellY)
+            endRow();
+        writeRun(backgroundType, cellX - x);
+        writeRun(cell, 1);
+    }
+    void finish(uint64_t height)
+    {
+        while(y < height)
+            endRow();
+        writeItem(1, "!");
+        os << "\n" << flush;
+    }
+};
+
+namespace
+{
+struct RLEBandNode
+{
+    const NodeType * node;
+    int64_t x;
+};
+
+struct RLEBoundsFinder
+{
+    NodeGCHashTable * gc;
+    CellType backgroundType;
+    bool empty = true;
+    int64_t minX = 0, minY = 0, maxX = 0, maxY = 0;
+    RLEBoundsFinder(NodeGCHashTable * gc, CellType backgroundType)
+        : gc(gc), backgroundType(backgroundType)
+    {
+    }
+    void addCell(int64_t x, int64_t y, CellType cell)
+    {
+        if(cell == backgroundType)
+            return;
+        if(empty)
+        {
+            minX = maxX = x;
+            minY = maxY = y;
+            empty = false;
+            return;
+        }
+        minX = min(minX, x);
+        maxX = max(maxX, x);
+        minY = min(minY, y);
+        maxY = max(maxY, y);
+    }
+    void visit(const NodeType * node, int64_t x, int64_t y)
+    {
+        int64_t size = (int64_t)2 << node->level;
+        if(!empty && x >= minX && y >= minY && x + size - 1 <= maxX && y + size - 1 <= maxY)
+            return;
+        if(node == gc->getNullNode(node->level, backgroundType))
+            return;
+        if(node->level == 0)
+        {
+            addCell(x, y, node->nxny.leaf);
+            addCell(x, y + 1, node->nxpy.leaf);
+            addCell(x + 1, y, node->pxny.leaf);
+            addCell(x + 1, y + 1, node->pxpy.leaf);
+            return;
+        }
+        int64_t halfSize = size / 2;
+        visit(node->nxny.nonleaf, x, y);
+        visit(node->pxny.nonleaf, x + halfSize, y);
+        visit(node->nxpy.nonleaf, x, y + halfSize);
+        visit(node->pxpy.nonleaf, x + halfSize, y + halfSize);
+    }
+};
+
+// walks horizontal bands of nodes top to bottom, only descending into non-background nodes
+void writeRLEBand(RLEWriter & writer, NodeGCHashTable * gc, CellType backgroundType, const vector<RLEBandNode> & band, size_t level, int64_t y, int64_t originX, int64_t originY)
+{
+    if(level == 0)
+    {
+        for(int row = 0; row < 2; row++)
+        {
+            for(const RLEBandNode & bandNode : band)
+            {
+                CellType left = (row == 0 ? bandNode.node->nxny.leaf : bandNode.node->nxpy.leaf);
+                CellType right = (row == 0 ? bandNode.node->pxny.leaf : bandNode.node->pxpy.leaf);
+                if(left != backgroundType)
+                    writer.writeCell(bandNode.x - originX, y + row - originY, left);
+                if(right != backgroundType)
+                    writer.writeCell(bandNode.x + 1 - originX, y + row - originY, right);
+            }
+        }
+        return;
+    }
+    const NodeType * nullNode = gc->getNullNode(level - 1, backgroundType);
+    int64_t halfSize = (int64_t)1 << level;
+    vector<RLEBandNode> subBand;
+    subBand.reserve(2 * band.size());
+    for(int row = 0; row < 2; row++)
+    {
+        subBand.clear();
+        for(const RLEBandNode & bandNode : band)
+        {
+            const NodeType * left = (row == 0 ? bandNode.node->nxny.nonleaf : bandNode.node->nxpy.nonleaf);
+            const NodeType * right = (row == 0 ? bandNode.node->pxny.nonleaf : bandNode.node->pxpy.nonleaf);
+            if(left != nullNode)
+                subBand.push_back(RLEBandNode{left, bandNode.x});
+            if(right != nullNode)
+                subBand.push_back(RLEBandNode{right, bandNode.x + halfSize});
+        }
+        if(!subBand.empty())
+            writeRLEBand(writer, gc, backgroundType, subBand, level - 1, y + row * halfSize, originX, originY);
+    }
+}
+}
+
+bool getPatternBounds(const GameState & gs, CellBounds & bounds)
+{
+    assert(gs);
+    if(gs.rootNode->level >= 62)
+        return false;
+    if(gs.backgroundType == 0)
+        return gs.getBounds(bounds);
+    // the cached node extents only cover nonzero cells
+    int64_t rootHalfSize = (int64_t)1 << gs.rootNode->level;
+    RLEBoundsFinder boundsFinder(gs.gc, gs.backgroundType);
+    boundsFinder.visit(gs.rootNode, -rootHalfSize, -rootHalfSize);
+    bounds = CellBounds{boundsFinder.empty, boundsFinder.minX, boundsFinder.minY, boundsFinder.maxX, boundsFinder.maxY};
+    return true;
+}
+
+bool writeRLE(ostream & os, const GameState & gs)
+{
+    CellBounds bounds;
+    if(!getPatternBounds(gs, bounds))
+        return false;
+    int64_t rootHalfSize = (int64_t)1 << gs.rootNode->level;
+    if(bounds.empty)
+    {
+        RLEWriter writer(os, 0, 0, 0, 0, gs.rule->toString(), 0);
+        writer.finish(0);
+        return true;
+    }
+    uint64_t width = bounds.maxX - bounds.minX + 1, height = bounds.maxY - bounds.minY + 1;
+    RLEWriter writer(os, width, height, bounds.minX, bounds.minY, gs.rule->toString(), gs.backgroundType);
+    if(gs.rootNode != gs.gc->getNullNode(gs.rootNode->level, gs.backgroundType))
+    {
+        vector<RLEBandNode> band{RLEBandNode{gs.rootNode, -rootHalfSize}};
+        writeRLEBand(writer, gs.gc, gs.backgroundType, band, gs.rootNode->level, -rootHalfSize, bounds.minX, bounds.minY);
+    }
+    writer.finish(height);
+    return true;
+}
+
+GameState readMacrocell(istream & is, NodeGCHashTable * gc, ostream & progress)
+{
+    progress << "reading ...\x1b[K\r" << flush;
+    string line;
+    if(!getline(is, line) || line.compare(0, 4, "[M2]") != 0)
+    {
+        progress << "read failed.\x1b[K\n" << flush;
+        return nullptr;
+    }
+    const Rule * rule = Rule::getLife();
+    BigUnsigned generation;
+    vector<NodeReference> nodes{nullptr}; // indexed by line number
+    while(getline(is, line))
+    {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if(line.empty())
+            continue;
+        if(line[0] == '#')
+        {
+            istringstream ss(line.substr(min<size_t>(2, line.size())));
+            string value;
+            bool good = true;
+            if(line.compare(0, 2, "#R") == 0)
+                good = (ss >> value) && (rule = Rule::parse(value)) != nullptr;
+            else if(line.compare(0, 2, "#G") == 0)
+                good = (ss >> value) && BigUnsigned::parse(value, generation);
+            if(!good)
+            {
+                progress << "read failed.\x1b[K\n" << flush;
+                return nullptr;
+            }
+            continue;
+        }
+        if(line[0] == '.' || line[0] == '*' || line[0] == '$')
+        {
+            CellType cells[8 * 8] = {};
+            size_t x = 0, y = 0;
+            for(char ch : line)
+            {
+                if(ch == '$')
+                {
+                    x = 0;
+                    y++;
+                    continue;
+                }
+                if(x >= 8 || y >= 8 || (ch != '.' && ch != '*'))
+                {
+                    progress << "read failed.\x1b[K\n" << flush;
+                    return nullptr;
+                }
+                cells[x++ + y * 8] = (ch == '*' ? 1 : 0);
+            }
+            nodes.push_back(buildNodeH(2, 0, 0, gc, CellArrayRegion<const CellType>{BiasedRegion{0, 0, 7, 7}, cells, 8}));
+            continue;
+        }
+        istringstream ss(line);
+        size_t sizeLog;
+        uint64_t nw, ne, sw, se;
+        if(!(ss >> sizeLog >> nw >> ne >> sw >> se) || sizeLog == 0)
+        {
+            progress << "read failed.\x1b[K\n" << flush;
+            return nullptr;
+        }
+        if(sizeLog == 1)
+        {
+            if(max(max(nw, ne), max(sw, se)) > 255)
+            {
+                progress << "read failed.\x1b[K\n" << flush;
+                return nullptr;
+            }
+            nodes.push_back(gc->findOrInsertLeaf(nw, sw, ne, se));
+            continue;
+        }
+        NodeReference children[4];
+        uint64_t childLines[4] = {nw, sw, ne, se};
+        for(size_t i = 0; i < 4; i++)
+        {
+            if(childLines[i] >= nodes.size())
+            {
+                progress << "read failed.\x1b[K\n" << flush;
+                return nullptr;
+            }
+            children[i] = (childLines[i] == 0 ? gc->getNullNode(sizeLog - 2, 0) : nodes[childLines[i]]);
+            if(children[i]->level != sizeLog - 2)
+            {
+                progress << "read failed.\x1b[K\n" << flush;
+                return nullptr;
+            }
+        }
+        nodes.push_back(gc->findOrInsertNonleaf(children[0], children[1], children[2], children[3]));
+    }
+    progress << "read.\x1b[K\n" << flush;
+    return GameState(gc, nodes.size() > 1 ? nodes.back() : nullptr, 0, generation, rule);
+}
+
+bool writeMacrocell(ostream & os, const GameState & gs)
+{
+    assert(gs);
+    if(gs.backgroundType != 0)
+        return false;
+    os << "[M2] (hashlife)\n#R " << gs.rule->toString() << "\n";
+    if(gs.generation)
+        os << "#G " << gs.generation << "\n";
+    struct Walker
+    {
+        ostream & os;
+        NodeGCHashTable * gc;
+        bool useBlocks; // level 2 nodes are written as 8 by 8 blocks
+        unordered_map<const NodeType *, uint64_t> lineNumbers;
+        uint64_t lineCount;
+        // writes the 8 by 8 block with node's top left corner at (offset, offset)
+        void writeBlock(const NodeType * node, uint64_t offset)
+        {
+            CellType cells[8 * 8] = {};
+            getRegionH(node, offset, offset, gc, 0, CellArrayRegion<CellType>{BiasedRegion{0, 0, 7, 7}, cells, 8});
+            string block;
+            for(size_t y = 0; y < 8; y++)
+            {
+                string row;
+                for(size_t x = 0; x < 8; x++)
+                    row += (cells[x + y * 8] ? '*' : '.');
+                row.erase(row.find_last_not_of('.') + 1);
+                block += row + "$";
+            }
+            block.erase(block.find_last_not_of('$') + 2);
+            os << block << "\n";
+        }
+        uint64_t add(const NodeType * node)
+        {
+            if(node->getPopulation() == 0)
+                return 0;
+            auto iter = lineNumbers.find(node);
+            if(iter != lineNumbers.end())
+                return iter->second;
+            if(useBlocks && node->level == 2)
+                writeBlock(node, 0);
+            else if(node->level == 0)
+                os << "1 " << node->nxny.leaf << " " << node->pxny.leaf << " " << node->nxpy.leaf << " " << node->pxpy.leaf << "\n";
+            else
+            {
+                uint64_t nw = add(node->nxny.nonleaf), ne = add(node->pxny.nonleaf);
+                uint64_t sw = add(node->nxpy.nonleaf), se = add(node->pxpy.nonleaf);
+                os << node->level + 1 << " " << nw << " " << ne << " " << sw << " " << se << "\n";
+            }
+            return lineNumbers[node] = ++lineCount;
+        }
+    } walker{os, gs.gc, false, unordered_map<const NodeType *, uint64_t>(), 0};
+    if(getCellCounts(gs.rootNode).rbegin()->first <= 1)
+    {
+        walker.useBlocks = true;
+        if(gs.rootNode->level < 2 && gs.rootNode->getPopulation() != 0)
+        {
+            // center the small root in one block
+            walker.writeBlock(gs.rootNode, 4 - ((uint64_t)1 << gs.rootNode->level));
+            return (bool)os;
+        }
+    }
+    walker.add(gs.rootNode);
+    return (bool)os;
+}
+
+GameState readPattern(istream & is, NodeGCHashTable * gc, ostream & progress)
+{
+    if(is.peek() == '[')
+        return readMacrocell(is, gc, progress);
+    return readRLE(is, gc, progress);
+}
+
+bool writePattern(ostream & os, const GameState & gs, const string & fileName)
+{
+    if(fileName.size() >= 3 && fileName.compare(fileName.size() - 3, 3, ".mc") == 0)
+        return writeMacrocell(os, gs);
+    return writeRLE(os, gs);
+}
+
+namespace
+{
+struct PNGChunkWriter
+{
+    ostream & os;
+    uint32_t crcTable[256];
+    string data;
+    explicit PNGChunkWriter(ostream & os)
+        : os(os)
+    {
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t crc = i;
+            for(int bit = 0; bit < 8; bit++)
+                crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+            crcTable[i] = crc;
+        }
+    }
+    void put8(uint8_t v)
+    {
+        data += (char)v;
+    }
+    void put32(uint32_t v) // big endian
+    {
+        put8(v >> 24);
+        put8(v >> 16);
+        put8(v >> 8);
+        put8(v);
+    }
+    void write(const char * type)
+    {
+        data = string(type, 4) + data;
+        uint32_t crc = 0xFFFFFFFF;
+        for(char ch : data)
+            crc = crcTable[(crc ^ (uint8_t)ch) & 0xFF] ^ (crc >> 8);
+        uint32_t length = data.size() - 4;
+        const char lengthBytes[4] = {(char)(length >> 24), (char)(length >> 16), (char)(length >> 8), (char)length};
+        os.write(lengthBytes, 4);
+        crc ^= 0xFFFFFFFF;
+        data += string{(char)(crc >> 24), (char)(crc >> 16), (char)(crc >> 8), (char)crc};
+        os.write(data.data(), data.size());
+        data.clear();
+    }
+};
+}
+
+bool writePNG(ostream & os, const Color * pixels, int w, int h, int pitch)
+{
+    assert(w > 0 && h > 0);
+    PNGChunkWriter writer(os);
+    os.write("\x89PNG\r\n\x1a\n", 8);
+    writer.put32(w);
+    writer.put32(h);
+    writer.put8(8); // bit depth
+    writer.put8(2); // RGB
+    writer.put8(0); // deflate
+    writer.put8(0); // adaptive filtering
+    writer.put8(0); // no interlace
+    writer.write("IHDR");
+    // a zlib stream of stored deflate blocks; each row is a 0 (no filter) byte then the pixels
+    string image;
+    image.reserve((size_t)h * (1 + 3 * (size_t)w));
+    for(int y = 0; y < h; y++)
+    {
+        const Color * row = (const Color *)((const char *)pixels + (size_t)y * pitch);
+        image += '\0';
+        for(int x = 0; x < w; x++)
+        {
+            image += (char)getR(row[x]);
+            image += (char)getG(row[x]);
+            image += (char)getB(row[x]);
+        }
+    }
+    writer.put8(0x78);
+    writer.put8(0x01);
+    constexpr size_t maxBlockSize = 65535;
+    for(size_t start = 0; start < image.size(); start += maxBlockSize)
+    {
+        size_t blockSize = min(maxBlockSize, image.size() - start);
+        writer.put8(start + blockSize == image.size() ? 1 : 0); // is the last block
+        writer.put8(blockSize);
+        writer.put8(blockSize >> 8);
+        writer.put8(~blockSize);
+        writer.put8(~blockSize >> 8);
+        writer.data.append(image, start, blockSize);
+    }
+    uint32_t adlerA = 1, adlerB = 0;
+    for(size_t start = 0; start < image.size(); start += 5552) // the longest run that can't overflow before the modulo
+    {
+        for(size_t i = start; i < min(image.size(), start + 5552); i++)
+        {
+            adlerA += (uint8_t)image[i];
+            adlerB += adlerA;
+        }
+        adlerA %= 65521;
+        adlerB %= 65521;
+    }
+    writer.put32((adlerB << 16) | adlerA);
+    writer.write("IDAT");
+    writer.write("IEND");
+    return (bool)os;
+}
+
+bool writeRawRGB(ostream & os, const Color * pixels, int w, int h, int pitch)
+{
+    string row;
+    row.reserve(3 * (size_t)w);
+    for(int y = 0; y < h; y++)
+    {
+        const Color * pixelRow = (const Color *)((const char *)pixels + (size_t)y * pitch);
+        row.clear();
+        for(int x = 0; x < w; x++)
+        {
+            row += (char)getR(pixelRow[x]);
+            row += (char)getG(pixelRow[x]);
+            row += (char)getB(pixelRow[x]);
+        }
+        os.write(row.data(), row.size());
+    }
+    return (bool)os;
+}
+
+// checkpoint file format : a header, the generation as 32-bit words (least significant first,
+// padded to a multiple of 8 bytes) and then an array of fixed-size node records.
+// every record only references records before it, so the loader reads the file through a read-only mapping
+// in one pass, interning each record's node in the table and restoring its memoized next state.
+struct CheckpointHeader
+{
+    static constexpr uint64_t currentVersion = 1;
+    char magic[8];
+    uint64_t version;
+    uint64_t nodeCount;
+    uint64_t rootIndex;
+    uint64_t backgroundType;
+    char rules[64];
+    uint64_t generationWordCount;
+    static const char * getMagic()
+    {
+        return "HLCKPT\r\n";
+    }
+    static size_t getGenerationSize(uint64_t generationWordCount)
+    {
+        return (generationWordCount * sizeof(BigUnsigned::Word) + 7) & ~(size_t)7;
+    }
+};
+
+struct CheckpointNodeRecord
+{
+    static constexpr uint64_t noNextState = ~(uint64_t)0;
+    uint64_t level;
+    uint64_t nxny, nxpy, pxny, pxpy; // cell values for leaves, record indices otherwise
+    uint64_t nextState;
+    uint64_t nextStateLogStep;
+};
+
+class MappedFile
+{
+    MappedFile(const MappedFile &) = delete;
+    const MappedFile &operator =(const MappedFile &) = delete;
+private:
+    const char *dataPointer = nullptr;
+    size_t dataSize = 0;
+#ifdef USE_MMAP
+    void *mapping = nullptr;
+#else
+    vector<char> buffer;
+#endif // USE_MMAP
+public:
+    explicit MappedFile(string fileName)
+    {
+#ifdef USE_MMAP
+        int fd = open(fileName.c_str(), O_RDONLY);
+        if(fd < 0)
+            return;
+        struct stat fileStat;
+        if(fstat(fd, &fileStat) == 0 && fileStat.st_size > 0)
+        {
+            void *ptr = mmap(nullptr, (size_t)fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(ptr != MAP_FAILED)
+            {
+                mapping = ptr;
+                dataPointer = (const char *)ptr;
+                dataSize = (size_t)fileStat.st_size;
+            }
+        }
+        close(fd);
+#else
+        ifstream is(fileName.c_str(), ios::binary);
+        if(!is)
+            return;
+        buffer.assign(istreambuf_iterator<char>(is), istreambuf_iterator<char>());
+        dataPointer = buffer.data();
+        dataSize = buffer.size();
+#endif // USE_MMAP
+    }
+    ~MappedFile()
+    {
+#ifdef USE_MMAP
+        if(mapping != nullptr)
+            munmap(mapping, dataSize);
+#endif // USE_MMAP
+    }
+    bool good() const
+    {
+        return dataPointer != nullptr;
+    }
+    const char * data() const
+    {
+        return dataPointer;
+    }
+    size_t size() const
+    {
+        return dataSize;
+    }
+};
+
+bool writeCheckpoint(string fileName, const GameState & gs)
+{
+    assert(gs);
+    unordered_map<const NodeType *, uint64_t> nodeIndexes;
+    nodeIndexes.reserve(gs.gc->nodeCount + 1);
+    vector<CheckpointNodeRecord> records;
+    records.reserve(gs.gc->nodeCount);
+    // post-order walk so that children and next states are written before their users; it only copies plain
+    // records with gc held off, so no references are kept while the file is written
+    struct Walker
+    {
+        unordered_map<const NodeType *, uint64_t> & nodeIndexes;
+        vector<CheckpointNodeRecord> & records;
+        const Rule * rule; // next states memoized for other rules are left out
+        uint64_t add(const NodeType * node)
+        {
+            auto iter = nodeIndexes.find(node);
+            if(iter != nodeIndexes.end())
+                return iter->second;
+            CheckpointNodeRecord record;
+            record.level = node->level;
+            record.nextState = CheckpointNodeRecord::noNextState;
+            record.nextStateLogStep = 0;
+            if(node->level == 0)
+            {
+                record.nxny = node->nxny.leaf;
+                record.nxpy = node->nxpy.leaf;
+                record.pxny = node->pxny.leaf;
+                record.pxpy = node->pxpy.leaf;
+            }
+            else
+            {
+                record.nxny = add(node->nxny.nonleaf);
+                record.nxpy = add(node->nxpy.nonleaf);
+                record.pxny = add(node->pxny.nonleaf);
+                record.pxpy = add(node->pxpy.nonleaf);
+                size_t nextStateLogStep;
+                NodeReference nextState = node->getNextStateMemo(rule, nextStateLogStep);
+                if(nextState != nullptr && nextState->level + 1 == node->level)
+                {
+                    record.nextState = add(nextState);
+                    record.nextStateLogStep = nextStateLogStep;
+                }
+            }
+            uint64_t index = records.size();
+            records.push_back(record);
+            nodeIndexes[node] = index;
+            return index;
+        }
+    } walker{nodeIndexes, records, gs.rule};
+    gs.gc->forEachNode([&](const NodeType * node)
+    {
+        walker.add(node);
+    });
+    uint64_t rootIndex = walker.add(gs.rootNode); // gs keeps the root, so it was walked above
+    CheckpointHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CheckpointHeader::getMagic(), sizeof(header.magic));
+    header.version = CheckpointHeader::currentVersion;
+    header.rootIndex = rootIndex;
+    header.nodeCount = records.size();
+    header.backgroundType = gs.backgroundType;
+    vector<BigUnsigned::Word> generationWords = gs.generation.getWords();
+    header.generationWordCount = generationWords.size();
+    generationWords.resize(CheckpointHeader::getGenerationSize(generationWords.size()) / sizeof(BigUnsigned::Word), 0);
+    string rulesString = gs.rule->toString();
+    assert(rulesString.size() < sizeof(header.rules));
+    memcpy(header.rules, rulesString.c_str(), rulesString.size());
+    string tempFileName = fileName + ".tmp";
+    ofstream os(tempFileName.c_str(), ios::binary | ios::trunc);
+    os.write((const char *)&header, sizeof(header));
+    os.write((const char *)generationWords.data(), generationWords.size() * sizeof(BigUnsigned::Word));
+    os.write((const char *)records.data(), records.size() * sizeof(CheckpointNodeRecord));
+    os.close();
+    if(!os)
+    {
+        remove(tempFileName.c_str());
+        return false;
+    }
+    return rename(tempFileName.c_str(), fileName.c_str()) == 0;
+}
+
+GameState readCheckpoint(string fileName, NodeGCHashTable * gc)
+{
+    cout << "reading checkpoint ...\x1b[K\r" << flush;
+    MappedFile file(fileName);
+    const CheckpointHeader * header = (const CheckpointHeader *)file.data();
+    size_t recordsOffset = 0;
+    BigUnsigned generation;
+    if(file.good() && file.size() >= sizeof(CheckpointHeader)
+            && memcmp(header->magic, CheckpointHeader::getMagic(), sizeof(header->magic)) == 0
+            && header->version == CheckpointHeader::currentVersion
+            && header->generationWordCount <= (file.size() - sizeof(CheckpointHeader)) / sizeof(BigUnsigned::Word))
+    {
+        const BigUnsigned::Word * generationWords = (const BigUnsigned::Word *)(file.data() + sizeof(CheckpointHeader));
+        generation = BigUnsigned::fromWords(vector<BigUnsigned::Word>(generationWords, generationWords + header->generationWordCount));
+        recordsOffset = sizeof(CheckpointHeader) + CheckpointHeader::getGenerationSize(header->generationWordCount);
+    }
+    if(recordsOffset == 0 || recordsOffset > file.size()
+            || header->rules[sizeof(header->rules) - 1] != '\0'
+            || header->nodeCount > (file.size() - recordsOffset) / sizeof(CheckpointNodeRecord)
+            || header->rootIndex >= header->nodeCount)
+    {
+        cout << "read failed.\x1b[K\n" << flush;
+        return nullptr;
+    }
+    if(header->nodeCount + gc->nodeCount > startGCNodeCount)
+    {
+        cout << "checkpoint too large.\x1b[K\n" << flush;
+        return nullptr;
+    }
+    const Rule * rule = Rule::parse(header->rules);
+    if(rule == nullptr)
+    {
+        cout << "read failed.\x1b[K\n" << flush;
+        return nullptr;
+    }
+    const CheckpointNodeRecord * records = (const CheckpointNodeRecord *)(file.data() + recordsOffset);
+    vector<NodeReference> nodes;
+    nodes.reserve(header->nodeCount);
+    for(uint64_t i = 0; i < header->nodeCount; i++)
+    {
+        const CheckpointNodeRecord & record = records[i];
+        if(record.level == 0)
+        {
+            nodes.push_back(gc->findOrInsertLeaf(record.nxny, record.nxpy, record.pxny, record.pxpy));
+            continue;
+        }
+        bool valid = true;
+        for(uint64_t child : {record.nxny, record.nxpy, record.pxny, record.pxpy})
+        {
+            if(child >= i || nodes[child]->level + 1 != record.level)
+                valid = false;
+        }
+        if(record.nextState != CheckpointNodeRecord::noNextState)
+        {
+            if(record.nextState >= i || nodes[record.nextState]->level + 1 != record.level || record.nextStateLogStep >= record.level)
+                valid = false;
+        }
+        if(!valid)
+        {
+            cout << "read failed.\x1b[K\n" << flush;
+            return nullptr;
+        }
+        NodeReference node = gc->findOrInsertNonleaf(nodes[record.nxny], nodes[record.nxpy], nodes[record.pxny], nodes[record.pxpy]);
+        if(record.nextState != CheckpointNodeRecord::noNextState)
+        {
+            node->setNextStateMemo(nodes[record.nextState], rule, record.nextStateLogStep);
+        }
+        nodes.push_back(node);
+        if(i % 100000 == 0)
+            cout << "reading checkpoint ... " << i << "/" << header->nodeCount << "\x1b[K\r" << flush;
+    }
+    cout << "read.\x1b[K\n" << flush;
+    return GameState(gc, nodes[header->rootIndex], header->backgroundType, generation, rule);
+}
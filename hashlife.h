@@ -0,0 +1,3534 @@
+#ifndef HASHLIFE_H_INCLUDED
+#define HASHLIFE_H_INCLUDED
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <cassert>
+#include <thread>
+#include <iostream>
+#include <initializer_list>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <map>
+#include <list>
+#include <deque>
+#include <functional>
+#include <sstream>
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <memory>
+#include <condition_variable>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstddef>
+#include "biginteger.h"
+
+using namespace std;
+
+#ifdef __EMSCRIPTEN__
+constexpr size_t maxNodeCount = 600000;
+#else
+constexpr size_t maxNodeCount = 3000000;
+#endif
+constexpr size_t startGCNodeCount = 6 * maxNodeCount / 7;
+
+typedef uint_least32_t CellType;
+
+typedef uint32_t Color;
+
+constexpr Color RGBA(int R, int G, int B, int A)
+{
+    return (((Color)A & 0xFF) << 24) | (((Color)R & 0xFF) << 16) | (((Color)G & 0xFF) << 8) | ((
+                Color)B & 0xFF);
+}
+
+constexpr Color RGB(int R, int G, int B)
+{
+    return RGBA(R, G, B, 0xFF);
+}
+
+constexpr int getR(Color c)
+{
+    return (int)((c >> 16) & 0xFF);
+}
+
+constexpr int getG(Color c)
+{
+    return (int)((c >> 8) & 0xFF);
+}
+
+constexpr int getB(Color c)
+{
+    return (int)(c & 0xFF);
+}
+
+constexpr int getA(Color c)
+{
+    return (int)((c >> 24) & 0xFF);
+}
+
+typedef Color CellColorDescriptor;
+
+inline CellColorDescriptor getCellColorDescriptor(CellType cellType)
+{
+    switch(cellType % 8)
+    {
+    case 0:
+        if(cellType != 0)
+            return RGB(0x80, 0x80, 0x80);
+        return RGB(0, 0, 0);
+    case 7:
+        return RGB(0, 0, 0xFF);
+    case 2:
+        return RGB(0, 0xFF, 0);
+    case 3:
+        return RGB(0, 0xFF, 0xFF);
+    case 4:
+        return RGB(0xFF, 0, 0);
+    case 5:
+        return RGB(0xFF, 0, 0xFF);
+    case 6:
+        return RGB(0xFF, 0xFF, 0);
+    default:
+        return RGB(0xFF, 0xFF, 0xFF);
+    }
+}
+
+inline CellColorDescriptor combineCellColorDescriptors(initializer_list<CellColorDescriptor> descriptors)
+{
+    int R = 0, G = 0, B = 0;
+    size_t count = 0;
+    for(CellColorDescriptor descriptor : descriptors)
+    {
+        if((descriptor & RGBA(0xFF, 0xFF, 0xFF, 0)) != 0)
+        {
+            R += getR(descriptor);
+            G += getG(descriptor);
+            B += getB(descriptor);
+            count++;
+        }
+    }
+
+    if(count > 0)
+    {
+        R += count / 2;
+        G += count / 2;
+        B += count / 2;
+        R /= count;
+        G /= count;
+        B /= count;
+    }
+    return RGB(R, G, B);
+}
+
+inline Color getCellColorDescriptorColor(CellColorDescriptor descriptor)
+{
+    return descriptor;
+}
+
+// a birth and survival rule. rules are interned : there is one Rule for each distinct table and it is never freed,
+// so a Rule's address identifies it, which is what the memoized next states are tagged with
+class Rule
+{
+    Rule(const Rule &) = delete;
+    const Rule &operator =(const Rule &) = delete;
+public:
+    typedef array<array<CellType, 9>, 2> Table; // indexed by whether the cell is alive then by the live neighbor count
+private:
+    const Table table;
+    explicit Rule(const Table & table)
+        : table(table)
+    {
+    }
+public:
+    static const Rule * get(const Table & table)
+    {
+        static std::mutex theLock;
+        static vector<unique_ptr<const Rule>> rules;
+        lock_guard<std::mutex> lock(theLock);
+        for(const unique_ptr<const Rule> & rule : rules)
+        {
+            if(rule->table == table)
+                return rule.get();
+        }
+        rules.emplace_back(new Rule(table));
+        return rules.back().get();
+    }
+    static const Rule * getLife()
+    {
+        Table table = {};
+        table[0][3] = 1;
+        table[1][2] = 1;
+        table[1][3] = 1;
+        return get(table);
+    }
+    // parses rules like B3/S23; returns nullptr if rulesString isn't valid
+    static const Rule * parse(string rulesString)
+    {
+        Table table = {};
+        bool gotB = false, gotSlash = false, gotS = false;
+        for(char ch : rulesString)
+        {
+            if(ch == 'B')
+            {
+                if(gotB)
+                    return nullptr;
+                gotB = true;
+            }
+            else if(ch == '/')
+            {
+                if(!gotB || gotSlash)
+                    return nullptr;
+                gotSlash = true;
+            }
+            else if(ch == 'S')
+            {
+                if(!gotB || !gotSlash || gotS)
+                    return nullptr;
+                gotS = true;
+            }
+            else if(ch >= '0' && ch <= '8')
+            {
+                if(!gotB)
+                    return nullptr;
+                if(gotSlash)
+                {
+                    if(!gotS)
+                        return nullptr;
+                    if(table[1][ch - '0'])
+                        return nullptr;
+                    table[1][ch - '0'] = 1;
+                }
+                else
+                {
+                    if(table[0][ch - '0'])
+                        return nullptr;
+                    table[0][ch - '0'] = 1;
+                }
+            }
+            else
+                return nullptr;
+        }
+        return get(table);
+    }
+    string toString() const
+    {
+        string retval = "B";
+        for(size_t i = 0; i < table[0].size(); i++)
+        {
+            if(table[0][i])
+                retval += (char)('0' + i);
+        }
+        retval += "/S";
+        for(size_t i = 0; i < table[1].size(); i++)
+        {
+            if(table[1][i])
+                retval += (char)('0' + i);
+        }
+        return retval;
+    }
+    CellType eval(CellType nxny, CellType nxcy, CellType nxpy,
+                  CellType cxny, CellType cxcy, CellType cxpy,
+                  CellType pxny, CellType pxcy, CellType pxpy) const
+    {
+        size_t count = 0;
+
+        if(nxny != 0)
+        {
+            count++;
+        }
+
+        if(nxcy != 0)
+        {
+            count++;
+        }
+
+        if(nxpy != 0)
+        {
+            count++;
+        }
+
+        if(cxpy != 0)
+        {
+            count++;
+        }
+
+        if(pxpy != 0)
+        {
+            count++;
+        }
+
+        if(pxcy != 0)
+        {
+            count++;
+        }
+
+        if(pxny != 0)
+        {
+            count++;
+        }
+
+        if(cxny != 0)
+        {
+            count++;
+        }
+
+        if(cxcy != 0)
+        {
+            return table[1][count];
+        }
+
+        return table[0][count];
+    }
+};
+
+struct NodeGCHashTable;
+struct NodeType;
+
+class NodeReference
+{
+private:
+    const NodeType *node;
+    void incRefCount();
+    void decRefCount();
+    NodeReference(const NodeType *node, bool doIncrementRefcount)
+        : node(node)
+    {
+        if(doIncrementRefcount && node != nullptr)
+        {
+            incRefCount();
+        }
+    }
+public:
+    NodeReference(const NodeType *node = nullptr)
+        : NodeReference(node, true)
+    {
+    }
+    NodeReference(const NodeReference &rt)
+        : NodeReference(rt.node, true)
+    {
+    }
+    NodeReference(NodeReference &&rt)
+        : node(rt.node)
+    {
+        rt.node = nullptr;
+    }
+    const NodeReference &operator =(const NodeReference &rt)
+    {
+        if(rt.node == node)
+        {
+            return *this;
+        }
+
+        if(node != nullptr)
+        {
+            decRefCount();
+        }
+
+        node = rt.node;
+
+        if(node != nullptr)
+        {
+            incRefCount();
+        }
+
+        return *this;
+    }
+    const NodeReference &operator =(NodeReference && rt)
+    {
+        const NodeType *temp = rt.node;
+        rt.node = node;
+        node = temp;
+        return *this;
+    }
+    ~NodeReference()
+    {
+        if(node)
+        {
+            decRefCount();
+        }
+    }
+    operator const NodeType *() const
+    {
+        return node;
+    }
+    operator bool() const
+    {
+        return node != nullptr;
+    }
+    bool operator !() const
+    {
+        return node == nullptr;
+    }
+    const NodeType *operator ->() const
+    {
+        return node;
+    }
+    const NodeType &operator *() const
+    {
+        return *node;
+    }
+    friend bool operator ==(const NodeReference &a, std::nullptr_t)
+    {
+        return a.node == nullptr;
+    }
+    friend bool operator ==(std::nullptr_t, const NodeReference &b)
+    {
+        return b.node == nullptr;
+    }
+    friend bool operator !=(const NodeReference &a, std::nullptr_t)
+    {
+        return a.node != nullptr;
+    }
+    friend bool operator !=(std::nullptr_t, const NodeReference &b)
+    {
+        return b.node != nullptr;
+    }
+    friend bool operator ==(const NodeReference &a, const NodeType *b)
+    {
+        return a.node == b;
+    }
+    friend bool operator ==(const NodeType *a, const NodeReference &b)
+    {
+        return b.node == a;
+    }
+    friend bool operator !=(const NodeReference &a, const NodeType *b)
+    {
+        return a.node != b;
+    }
+    friend bool operator !=(const NodeType *a, const NodeReference &b)
+    {
+        return b.node != a;
+    }
+    friend bool operator ==(const NodeReference &a, const NodeReference &b)
+    {
+        return a.node == b.node;
+    }
+    friend bool operator !=(const NodeReference &a, const NodeReference &b)
+    {
+        return a.node != b.node;
+    }
+    const NodeType *detach()
+    {
+        const NodeType *retval = node;
+        node = nullptr;
+        return retval;
+    }
+    static NodeReference attach(const NodeType *node)
+    {
+        return NodeReference(node, false);
+    }
+};
+
+void dump(NodeReference rootNode);
+
+inline void lock(std::initializer_list<atomic_bool *> locks)
+{
+    static size_t startDelayCount = 10000;
+    size_t startCount = 0;
+
+    for(;;)
+    {
+        bool anyLocked = false;
+
+        for(auto i = locks.begin(); i != locks.end(); i++)
+        {
+            if(**i)
+            {
+                anyLocked = true;
+                break;
+            }
+        }
+
+        if(!anyLocked)
+        {
+            bool anyLocked = false;
+
+            for(auto i = locks.begin(); i != locks.end(); i++)
+            {
+                if((*i)->exchange(true))
+                {
+                    for(auto j = locks.begin(); j != i; j++)
+                    {
+                        **j = false;
+                    }
+
+                    anyLocked = true;
+                    break;
+                }
+            }
+
+            if(!anyLocked)
+            {
+                return;
+            }
+        }
+
+        if(startCount < startDelayCount)
+        {
+            startCount++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+inline void lock(atomic_bool &theLock)
+{
+    lock(initializer_list<atomic_bool *> {&theLock});
+}
+
+inline void unlock(atomic_bool &theLock)
+{
+    theLock = false;
+}
+
+class ThreadPool
+{
+    ThreadPool(const ThreadPool &) = delete;
+    const ThreadPool &operator =(const ThreadPool &) = delete;
+private:
+    vector<thread> threads;
+    std::mutex theLock;
+    condition_variable cond;
+    deque<function<void()>> tasks;
+    bool done = false;
+    void run()
+    {
+        unique_lock<std::mutex> lockIt(theLock);
+        for(;;)
+        {
+            while(tasks.empty() && !done)
+                cond.wait(lockIt);
+            if(tasks.empty())
+                return;
+            function<void()> task = std::move(tasks.front());
+            tasks.pop_front();
+            lockIt.unlock();
+            task();
+            lockIt.lock();
+        }
+    }
+public:
+    static size_t getDefaultThreadCount()
+    {
+#ifdef __EMSCRIPTEN__
+        return 0;
+#else
+        size_t retval = thread::hardware_concurrency();
+        return retval > 1 ? retval - 1 : 0; // the thread waiting on the pool works too
+#endif // __EMSCRIPTEN__
+    }
+    explicit ThreadPool(size_t threadCount = getDefaultThreadCount())
+    {
+        for(size_t i = 0; i < threadCount; i++)
+        {
+            threads.push_back(thread([this]()
+            {
+                run();
+            }));
+        }
+    }
+    ~ThreadPool()
+    {
+        {
+            lock_guard<std::mutex> lockIt(theLock);
+            done = true;
+        }
+        cond.notify_all();
+        for(thread & t : threads)
+        {
+            t.join();
+        }
+    }
+    size_t size() const
+    {
+        return threads.size();
+    }
+    void submit(function<void()> task)
+    {
+        if(threads.empty())
+        {
+            task();
+            return;
+        }
+        {
+            lock_guard<std::mutex> lockIt(theLock);
+            tasks.push_back(std::move(task));
+        }
+        cond.notify_one();
+    }
+    // calls fn(0) through fn(count - 1) on the pool and the calling thread; returns when all have finished
+    void parallelFor(size_t count, function<void(size_t)> fn)
+    {
+        struct State
+        {
+            atomic_size_t nextIndex;
+            size_t runningCount = 0;
+            std::mutex theLock;
+            condition_variable cond;
+            State()
+                : nextIndex(0)
+            {
+            }
+        };
+        auto state = make_shared<State>();
+        auto worker = [state, count, fn]()
+        {
+            for(size_t i = state->nextIndex++; i < count; i = state->nextIndex++)
+            {
+                fn(i);
+            }
+        };
+        size_t helperCount = min(threads.size(), count > 0 ? count - 1 : 0);
+        state->runningCount = helperCount;
+        for(size_t i = 0; i < helperCount; i++)
+        {
+            submit([state, worker]()
+            {
+                worker();
+                lock_guard<std::mutex> lockIt(state->theLock);
+                if(--state->runningCount == 0)
+                    state->cond.notify_all();
+            });
+        }
+        worker();
+        unique_lock<std::mutex> lockIt(state->theLock);
+        while(state->runningCount > 0)
+            state->cond.wait(lockIt);
+    }
+};
+
+class NodeWeakReference
+{
+    friend struct NodeType;
+private:
+    mutable const NodeType *node;
+    mutable const NodeWeakReference *listNext;
+    mutable const NodeWeakReference *listPrev;
+    mutable atomic_bool locked; // always lock starting from the front-most element
+    void add();
+    void remove();
+public:
+    NodeWeakReference(const NodeType *node = nullptr)
+        : node(node), locked(false)
+    {
+        add();
+    }
+    NodeWeakReference(NodeReference node)
+        : NodeWeakReference((const NodeType *)node)
+    {
+    }
+    ~NodeWeakReference()
+    {
+        remove();
+    }
+    NodeWeakReference(const NodeWeakReference &rt)
+        : locked(false)
+    {
+        lock(rt.locked);
+        node = rt.node;
+        unlock(rt.locked);
+        add();
+    }
+    const NodeWeakReference &operator =(const NodeWeakReference &rt)
+    {
+        lock(initializer_list<atomic_bool *> {&rt.locked, &locked});
+
+        if(node == rt.node)
+        {
+            unlock(locked);
+            unlock(rt.locked);
+            return *this;
+        }
+
+        const NodeType *newNode = rt.node;
+        unlock(locked);
+        unlock(rt.locked);
+        remove();
+        lock(locked);
+        node = newNode;
+        unlock(locked);
+        add();
+        return *this;
+    }
+    const NodeWeakReference &operator =(const NodeType *newNode)
+    {
+        lock(locked);
+
+        if(node == newNode)
+        {
+            unlock(locked);
+            return *this;
+        }
+
+        unlock(locked);
+        remove();
+        lock(locked);
+        node = newNode;
+        unlock(locked);
+        add();
+        return *this;
+    }
+    const NodeWeakReference &operator =(NodeReference newNode)
+    {
+        return operator =((const NodeType *)newNode);
+    }
+    NodeReference get() const;
+};
+
+// lets other threads cancel a running step and see how far along it is
+struct StepControl
+{
+    static constexpr size_t subproblemCount = 13; // subproblems solved by the root's getNextState
+    atomic_bool cancelled;
+    atomic_size_t completedSubproblemCount;
+    atomic_size_t rootLevel;
+    StepControl()
+        : cancelled(false), completedSubproblemCount(0), rootLevel(0)
+    {
+    }
+    void start(size_t rootLevel)
+    {
+        completedSubproblemCount = 0;
+        this->rootLevel = rootLevel;
+    }
+    void cancel()
+    {
+        cancelled = true;
+    }
+    double getProgress() const
+    {
+        return (double)completedSubproblemCount / subproblemCount;
+    }
+    // returns false if the subproblem was cancelled
+    static bool subproblemDone(StepControl *control, size_t level, const NodeReference & result)
+    {
+        if(result == nullptr)
+            return false;
+        if(control != nullptr && level == control->rootLevel)
+            control->completedSubproblemCount++;
+        return true;
+    }
+    static bool isCancelled(const StepControl *control)
+    {
+        return control != nullptr && control->cancelled;
+    }
+};
+
+struct NodeType
+{
+    NodeType(const NodeType &) = delete;
+    const NodeType &operator =(const NodeType &) = delete;
+    mutable atomic_uint_least32_t refcount; // wide enough for many threads holding the same common nodes
+    mutable uint_least8_t gcFlags = 0;
+    mutable atomic_bool weakListHeadLocked;
+    mutable atomic_bool removing, testingForRemove;
+    static constexpr uint_least8_t UsedFlag = 0x1;
+    bool used() const
+    {
+        return gcFlags & UsedFlag;
+    }
+    void used(bool v) const
+    {
+        if(v)
+        {
+            gcFlags |= UsedFlag;
+        }
+        else
+        {
+            gcFlags &= ~UsedFlag;
+        }
+    }
+    mutable const NodeType *hashNext = nullptr;
+    mutable const NodeType *gcNext = nullptr;  // pointer for gc uses
+    mutable const NodeWeakReference *weakListHead = nullptr;
+    mutable atomic_size_t weakGetCount;
+    const size_t level;
+    union SectionType
+    {
+        CellType leaf;
+        const NodeType *nonleaf;
+        SectionType(CellType leaf)
+            : leaf(leaf)
+        {
+        }
+        SectionType(const NodeType *nonleaf)
+            : nonleaf(nonleaf)
+        {
+        }
+    };
+    SectionType nxny;
+    SectionType nxpy;
+    SectionType pxny;
+    SectionType pxpy;
+    // memoized next states, each for a different rule, most recently set first, so states with different rules that share
+    // nodes don't keep evicting each other's results. their log step sizes are with the small fields at the end
+    static constexpr size_t nextStateMemoCount = 2;
+    mutable NodeWeakReference nextStates[nextStateMemoCount];
+    mutable const Rule *nextStateRules[nextStateMemoCount] = {}; // the rule each next state was computed with
+    static constexpr uint64_t populationUnknown = ~(uint64_t)0;
+    static constexpr uint64_t populationTooBig = populationUnknown - 1;
+    mutable atomic_uint_fast64_t cachedPopulation; // nonzero cell count, filled in by getPopulation
+    mutable atomic_uint_fast64_t cachedNonOnePopulation; // count of cells that aren't 1, for rules with B0 where the background flips to 1
+    static constexpr CellColorDescriptor cellColorDescriptorUnknown = 0; // every combined descriptor is opaque
+    static constexpr size_t maxExtentLevel = 62; // bigger nodes don't fit 64-bit extents
+    // nodes up to this level cache their extent in 32-bit fields; the few bigger ones in a tree rebuild it from their children
+    static constexpr size_t maxCachedExtentLevel = 31;
+    struct Extent // of the nonzero cells, relative to the top left corner of the node
+    {
+        uint64_t minX, minY, maxX, maxY;
+        static Extent makeEmpty()
+        {
+            return Extent{~(uint64_t)0, ~(uint64_t)0, 0, 0};
+        }
+        bool empty() const
+        {
+            return minX > maxX;
+        }
+        void add(const Extent & extent, uint64_t offsetX, uint64_t offsetY)
+        {
+            if(extent.empty())
+                return;
+            if(empty())
+            {
+                *this = Extent{extent.minX + offsetX, extent.minY + offsetY, extent.maxX + offsetX, extent.maxY + offsetY};
+                return;
+            }
+            minX = min(minX, extent.minX + offsetX);
+            minY = min(minY, extent.minY + offsetY);
+            maxX = max(maxX, extent.maxX + offsetX);
+            maxY = max(maxY, extent.maxY + offsetY);
+        }
+    };
+    mutable atomic_uint_least32_t extentMinX, extentMinY, extentMaxX, extentMaxY; // filled in by getExtent
+    // the small fields last, so that they pack together
+    mutable uint_least16_t nextStateLogSteps[nextStateMemoCount] = {};
+    mutable atomic_bool nextStateLocked; // keeps the next state memos consistent between threads
+    mutable atomic_bool extentKnown;
+    // the average color, filled in by getOverallCellColorDescriptor when the node is first drawn smaller than a pixel,
+    // so the nodes stepping creates and never draws don't pay for it
+    mutable atomic_uint_least32_t cachedOverallCellColorDescriptor;
+    NodeType(CellType nxny, CellType nxpy, CellType pxny, CellType pxpy)
+        : refcount(0), weakListHeadLocked(false), removing(false), testingForRemove(false), weakGetCount(0),
+          level(0), nxny(nxny), nxpy(nxpy), pxny(pxny), pxpy(pxpy),
+          cachedPopulation(populationUnknown), cachedNonOnePopulation(populationUnknown),
+          extentMinX(0), extentMinY(0), extentMaxX(0), extentMaxY(0),
+          nextStateLocked(false), extentKnown(false), cachedOverallCellColorDescriptor(cellColorDescriptorUnknown)
+    {
+    }
+    NodeType(const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy)
+        : refcount(0), weakListHeadLocked(false), removing(false), testingForRemove(false), weakGetCount(0),
+          level(1 + nxny->level), nxny(nxny), nxpy(nxpy), pxny(pxny), pxpy(pxpy),
+          cachedPopulation(populationUnknown), cachedNonOnePopulation(populationUnknown),
+          extentMinX(0), extentMinY(0), extentMaxX(0), extentMaxY(0),
+          nextStateLocked(false), extentKnown(false), cachedOverallCellColorDescriptor(cellColorDescriptorUnknown)
+    {
+    }
+    ~NodeType()
+    {
+        removing = true;
+        // nullify all weak references
+        lock(weakListHeadLocked);
+        const NodeWeakReference *node = weakListHead;
+
+        while(node != nullptr)
+        {
+            lock(node->locked);
+            const NodeWeakReference *nextNode = node->listNext;
+            node->node = nullptr;
+            node->listPrev = nullptr;
+            node->listNext = nullptr;
+            unlock(node->locked);
+            node = nextNode;
+        }
+    }
+    // the next state memoized for rule with the log step size it was computed with; nullptr (and a log step size of 0)
+    // if there is none
+    NodeReference getNextStateMemo(const Rule *rule, size_t & logStepSize) const
+    {
+        NodeReference retval = nullptr;
+        logStepSize = 0;
+        lock(nextStateLocked);
+        for(size_t i = 0; i < nextStateMemoCount; i++)
+        {
+            if(nextStateRules[i] == rule)
+            {
+                retval = nextStates[i].get();
+                logStepSize = nextStateLogSteps[i];
+                break;
+            }
+        }
+        unlock(nextStateLocked);
+        return retval;
+    }
+    // replaces the next state memoized for rule, or the least recently set one if there is none
+    void setNextStateMemo(NodeReference nextState, const Rule *rule, size_t logStepSize) const
+    {
+        assert(logStepSize <= 0xFFFF);
+        lock(nextStateLocked);
+        size_t index = 0;
+        while(index < nextStateMemoCount - 1 && nextStateRules[index] != rule)
+            index++;
+        for(; index > 0; index--)
+        {
+            nextStates[index] = nextStates[index - 1];
+            nextStateRules[index] = nextStateRules[index - 1];
+            nextStateLogSteps[index] = nextStateLogSteps[index - 1];
+        }
+        nextStates[0] = nextState;
+        nextStateRules[0] = rule;
+        nextStateLogSteps[0] = (uint_least16_t)logStepSize;
+        unlock(nextStateLocked);
+    }
+    // return nullptr if cancelled through control
+    NodeReference getNextState(NodeGCHashTable *gc, const Rule *rule, StepControl *control = nullptr) const;
+    NodeReference getNextState(NodeGCHashTable *gc, const Rule *rule, size_t logStepSize, StepControl *control = nullptr) const;
+    NodeReference getCenter(NodeGCHashTable *gc) const;
+    // the number of cells that aren't backgroundType, computed once per node for each of the backgrounds 0 and 1,
+    // which are the only ones stepping makes; populationTooBig if it doesn't fit in 64 bits
+    uint64_t getPopulation(CellType backgroundType = 0) const;
+    // the average color of the nonzero cells, computed once per node when it's first drawn
+    CellColorDescriptor getOverallCellColorDescriptor() const;
+    // the extent of the nonzero cells, computed once per node up to maxCachedExtentLevel; level must be at most maxExtentLevel
+    Extent getExtent() const;
+};
+
+inline void NodeReference::incRefCount()
+{
+    node->refcount++;
+}
+
+inline void NodeReference::decRefCount()
+{
+    node->refcount--;
+}
+
+inline void NodeWeakReference::add()
+{
+    lock(locked);
+    listPrev = nullptr;
+    listNext = nullptr;
+
+    if(node != nullptr)
+    {
+        lock(node->weakListHeadLocked);
+
+        if(node->weakListHead != nullptr)
+        {
+            lock(node->weakListHead->locked);
+            node->weakListHead->listPrev = this;
+            unlock(node->weakListHead->locked);
+        }
+
+        listNext = node->weakListHead;
+        node->weakListHead = this;
+        unlock(locked);
+        unlock(node->weakListHeadLocked);
+    }
+    else
+    {
+        unlock(locked);
+    }
+}
+
+inline void NodeWeakReference::remove()
+{
+    lock(locked);
+
+    if(node == nullptr)
+    {
+        unlock(locked);
+        return;
+    }
+
+    const NodeWeakReference *prev = listPrev;
+    unlock(locked);
+
+    for(;;)
+    {
+        // must lock in order
+        atomic_bool *const pPrevLock = (prev == nullptr ? &node->weakListHeadLocked : &prev->locked);
+
+        if(prev == nullptr)
+        {
+            lock(node->weakListHeadLocked);
+        }
+        else
+        {
+            lock(prev->locked);
+        }
+
+        lock(locked);
+
+        if(prev != listPrev) // check for change while unlocked
+        {
+            unlock(locked);
+            unlock(*pPrevLock);
+            continue;
+        }
+
+        if(listPrev != nullptr)
+        {
+            listPrev->listNext = listNext;
+        }
+        else
+        {
+            node->weakListHead = listNext;
+        }
+
+        if(listNext != nullptr)
+        {
+            lock(listNext->locked);
+            listNext->listPrev = listPrev;
+            unlock(listNext->locked);
+        }
+
+        unlock(locked);
+        unlock(*pPrevLock);
+        break;
+    }
+}
+
+inline NodeReference NodeWeakReference::get() const
+{
+    lock(locked);
+
+    if(node == nullptr)
+    {
+        unlock(locked);
+        return NodeReference(nullptr);
+    }
+
+    node->weakGetCount++;
+
+    while(node->testingForRemove)
+    {
+        node->weakGetCount--;
+
+        while(node->testingForRemove)
+        {
+            std::this_thread::yield();
+        }
+
+        node->weakGetCount++;
+    }
+
+    NodeReference retval(node);
+    node->weakGetCount--;
+
+    if(node->removing)
+    {
+        unlock(locked);
+        return nullptr;
+    }
+
+    unlock(locked);
+    return retval;
+}
+
+inline size_t hashNodeLeaf(CellType nxny, CellType nxpy, CellType pxny, CellType pxpy)
+{
+    size_t retval = 3;
+    std::hash<CellType> hasher;
+    retval += hasher(nxny) + 9 * hasher(nxpy) + (9 * 9) * hasher(pxny) + (9 * 9 * 9) * hasher(pxpy);
+    return retval;
+}
+
+inline size_t hashNodeNonleaf(const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny,
+                const NodeType *pxpy)
+{
+    size_t retval = 0;
+    std::hash<const NodeType *> hasher;
+    retval += hasher(nxny) + 9 * hasher(nxpy) + (9 * 9) * hasher(pxny) + (9 * 9 * 9) * hasher(pxpy);
+    return retval;
+}
+
+namespace std
+{
+template<>
+struct hash<NodeType>
+{
+    size_t operator()(const NodeType &node) const
+    {
+        if(node.level == 0)
+        {
+            return hashNodeLeaf(node.nxny.leaf, node.nxpy.leaf, node.pxny.leaf, node.pxpy.leaf);
+        }
+
+        return hashNodeNonleaf(node.nxny.nonleaf, node.nxpy.nonleaf, node.pxny.nonleaf, node.pxpy.nonleaf);
+    }
+};
+
+template <>
+struct hash<NodeReference>
+{
+    hash<const NodeType *> hasher;
+    size_t operator()(const NodeReference & node) const
+    {
+        return hasher((const NodeType *)node);
+    }
+};
+}
+
+struct NodeGCHashTable
+{
+    static constexpr size_t hashPrime = 1008863;
+    const NodeType *table[hashPrime];
+    std::mutex tableLocks[hashPrime];
+    atomic_size_t nodeCount;
+    atomic_bool runningGC;
+    atomic_uint_fast64_t memoHitCount, memoMissCount; // getNextState lookups
+    // the same lookups made by the current thread in any table, so that the step size is tuned from a step's own lookups
+    // and not from those of other threads sharing the table
+    static thread_local uint64_t threadMemoHitCount, threadMemoMissCount;
+    void countMemoHit()
+    {
+        memoHitCount.fetch_add(1, memory_order_relaxed);
+        threadMemoHitCount++;
+    }
+    void countMemoMiss()
+    {
+        memoMissCount.fetch_add(1, memory_order_relaxed);
+        threadMemoMissCount++;
+    }
+    // threads inside a MutatorScope stop at the next allocation while gc runs, so that none of them can pick up
+    // a node between marking and sweeping; gc waits until all of them have stopped
+    atomic_size_t mutatorCount, stoppedMutatorCount;
+    atomic_bool stopMutators;
+    static thread_local size_t mutatorScopeDepth; // of the current thread
+private:
+    // next states of nodes that getNextState only passes around as their four children, instead of putting them in the table.
+    // lossy : a colliding entry replaces the old one. cleared by gc, so the children can't be freed and reused while they're keys
+    struct ChildrenNextState
+    {
+        const NodeType *nxny = nullptr, *nxpy = nullptr, *pxny = nullptr, *pxpy = nullptr;
+        const Rule *rule = nullptr;
+        size_t logStepSize = 0;
+        NodeReference nextState;
+        atomic_bool locked;
+        ChildrenNextState()
+            : locked(false)
+        {
+        }
+    };
+    static constexpr size_t childrenNextStateHashPrime = (maxNodeCount > 1000000 ? 393241 : 98317);
+    unique_ptr<ChildrenNextState[]> childrenNextStates;
+    ChildrenNextState & getChildrenNextStateEntry(const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy, const Rule *rule, size_t logStepSize)
+    {
+        size_t hash = hashNodeNonleaf(nxny, nxpy, pxny, pxpy) + (9 * 9 * 9 * 9) * std::hash<const Rule *>()(rule) + logStepSize;
+        return childrenNextStates[hash % childrenNextStateHashPrime];
+    }
+    void clearChildrenNextStates()
+    {
+        for(size_t i = 0; i < childrenNextStateHashPrime; i++)
+        {
+            ChildrenNextState & entry = childrenNextStates[i];
+            entry.nxny = entry.nxpy = entry.pxny = entry.pxpy = nullptr;
+            entry.nextState = nullptr;
+        }
+    }
+public:
+    NodeGCHashTable()
+        : nodeCount(0), runningGC(false), memoHitCount(0), memoMissCount(0), mutatorCount(0), stoppedMutatorCount(0), stopMutators(false),
+          childrenNextStates(new ChildrenNextState[childrenNextStateHashPrime])
+    {
+        for(const NodeType  *&node : table)
+        {
+            node = nullptr;
+        }
+    }
+    NodeGCHashTable(const NodeGCHashTable &) = delete;
+    const NodeGCHashTable &operator =(const NodeGCHashTable &) = delete;
+    ~NodeGCHashTable()
+    {
+        nullNodes.clear(); // before the nodes they reference are deleted
+        childrenNextStates.reset();
+        for(size_t i = 0; i < hashPrime; i++)
+        {
+            const NodeType *node;
+            {
+                std::lock_guard<std::mutex> lock(tableLocks[i]);
+                node = table[i];
+                table[i] = nullptr;
+            }
+
+            while(node != nullptr)
+            {
+                NodeType *deleteMe = (NodeType *)node;
+                node = node->hashNext;
+                deleteMe->removing = true;
+                delete deleteMe;
+            }
+        }
+    }
+private:
+    const NodeType *clearAllNodes()
+    {
+        const NodeType *usedListHead = nullptr;
+
+        for(size_t i = 0; i < hashPrime; i++)
+        {
+            std::lock_guard<std::mutex> lock(tableLocks[i]);
+            const NodeType *node = table[i];
+
+            while(node != nullptr)
+            {
+                bool used = (node->refcount > 0);
+                node->used(used);
+
+                if(used)
+                {
+                    node->gcNext = usedListHead;
+                    usedListHead = node;
+                }
+
+                node = node->hashNext;
+            }
+        }
+
+        return usedListHead;
+    }
+    void markNode(const NodeType *node)
+    {
+        if(node->used())
+        {
+            return;
+        }
+
+        node->used(true);
+
+        if(node->level > 0)
+        {
+            markNode(node->nxny.nonleaf);
+            markNode(node->nxpy.nonleaf);
+            markNode(node->pxny.nonleaf);
+            markNode(node->pxpy.nonleaf);
+        }
+    }
+    void markAllNodes(const NodeType *usedListHead)
+    {
+        while(usedListHead != nullptr)
+        {
+            const NodeType *node = usedListHead;
+            usedListHead = usedListHead->gcNext;
+            node->gcNext = nullptr;
+            node->used(true);
+
+            if(node->level > 0)
+            {
+                markNode(node->nxny.nonleaf);
+                markNode(node->nxpy.nonleaf);
+                markNode(node->pxny.nonleaf);
+                markNode(node->pxpy.nonleaf);
+            }
+        }
+    }
+    void sweepUnusedNodes()
+    {
+        for(size_t i = 0; i < hashPrime; i++)
+        {
+            std::lock_guard<std::mutex> lock(tableLocks[i]);
+            const NodeType **pnode = &table[i];
+            const NodeType *node = *pnode;
+
+            while(node != nullptr)
+            {
+                bool used = node->used();
+
+                if(!used)
+                {
+                    node->testingForRemove = true;
+
+                    while(node->weakGetCount > 0)
+                    {
+                        std::this_thread::yield();
+                    }
+
+                    if(node->refcount > 0)
+                    {
+                        used = true;
+                    }
+                    else
+                    {
+                        node->removing = true;
+                    }
+
+                    node->testingForRemove = false;
+                }
+
+                if(used)
+                {
+                    pnode = &node->hashNext;
+                    node = *pnode;
+                }
+                else
+                {
+                    NodeType *deleteMe = (NodeType *)node;
+                    *pnode = node->hashNext;
+                    nodeCount--;
+                    node = *pnode;
+                    delete deleteMe;
+                }
+            }
+        }
+    }
+    void gc()
+    {
+        clearChildrenNextStates();
+        markAllNodes(clearAllNodes());
+        sweepUnusedNodes();
+    }
+    void onAllocate()
+    {
+        if(stopMutators && mutatorScopeDepth > 0)
+            safepoint();
+        if(nodeCount > startGCNodeCount)
+        {
+            if(runningGC.exchange(true))
+            {
+                while(nodeCount > maxNodeCount && runningGC)
+                {
+                    if(mutatorScopeDepth > 0)
+                        safepoint();
+                    std::this_thread::yield();
+                }
+            }
+            else
+            {
+                stopMutators = true;
+                size_t thisThreadMutatorCount = mutatorScopeDepth > 0 ? 1 : 0;
+                while(stoppedMutatorCount + thisThreadMutatorCount < mutatorCount)
+                {
+                    std::this_thread::yield();
+                }
+                gc();
+                stopMutators = false;
+                runningGC = false;
+            }
+            if(nodeCount > maxNodeCount)
+            {
+                cerr << "out of memory" << endl;
+                exit(1);
+            }
+        }
+    }
+public:
+    // called by threads inside a MutatorScope; waits while gc runs
+    void safepoint()
+    {
+        if(!stopMutators)
+            return;
+        stoppedMutatorCount++;
+        while(stopMutators)
+        {
+            std::this_thread::yield();
+        }
+        stoppedMutatorCount--;
+    }
+    NodeReference findOrInsertLeaf(CellType nxny, CellType nxpy, CellType pxny, CellType pxpy)
+    {
+        onAllocate();
+        size_t hash = hashNodeLeaf(nxny, nxpy, pxny, pxpy) % hashPrime;
+        lock_guard<std::mutex> lock(tableLocks[hash]);
+        const NodeType **pnode = &table[hash];
+        const NodeType *node = *pnode;
+
+        while(node != nullptr)
+        {
+            if(node->level == 0 &&
+                    node->nxny.leaf == nxny &&
+                    node->nxpy.leaf == nxpy &&
+                    node->pxny.leaf == pxny &&
+                    node->pxpy.leaf == pxpy)
+            {
+                *pnode = node->hashNext;
+                node->hashNext = table[hash];
+                table[hash] = node;
+                return NodeReference(node);
+            }
+
+            pnode = &node->hashNext;
+            node = *pnode;
+        }
+
+        nodeCount++;
+        node = new NodeType(nxny, nxpy, pxny, pxpy);
+        node->hashNext = table[hash];
+        table[hash] = node;
+        return NodeReference(node);
+    }
+    // the node with these children if it's in the table, otherwise nullptr
+    NodeReference findNonleaf(const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy)
+    {
+        size_t hash = hashNodeNonleaf(nxny, nxpy, pxny, pxpy) % hashPrime;
+        lock_guard<std::mutex> lock(tableLocks[hash]);
+        for(const NodeType *node = table[hash]; node != nullptr; node = node->hashNext)
+        {
+            if(node->level > 0 &&
+                    node->nxny.nonleaf == nxny &&
+                    node->nxpy.nonleaf == nxpy &&
+                    node->pxny.nonleaf == pxny &&
+                    node->pxpy.nonleaf == pxpy)
+                return NodeReference(node);
+        }
+        return nullptr;
+    }
+    // nullptr if the next state isn't cached
+    NodeReference findChildrenNextState(const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy, const Rule *rule, size_t logStepSize)
+    {
+        ChildrenNextState & entry = getChildrenNextStateEntry(nxny, nxpy, pxny, pxpy, rule, logStepSize);
+        lock(entry.locked);
+        NodeReference retval = nullptr;
+        if(entry.nxny == nxny && entry.nxpy == nxpy && entry.pxny == pxny && entry.pxpy == pxpy && entry.rule == rule && entry.logStepSize == logStepSize)
+            retval = entry.nextState;
+        unlock(entry.locked);
+        return retval;
+    }
+    void setChildrenNextState(const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy, const Rule *rule, size_t logStepSize, NodeReference nextState)
+    {
+        ChildrenNextState & entry = getChildrenNextStateEntry(nxny, nxpy, pxny, pxpy, rule, logStepSize);
+        lock(entry.locked);
+        entry.nxny = nxny;
+        entry.nxpy = nxpy;
+        entry.pxny = pxny;
+        entry.pxpy = pxpy;
+        entry.rule = rule;
+        entry.logStepSize = logStepSize;
+        entry.nextState = nextState;
+        unlock(entry.locked);
+    }
+    NodeReference findOrInsertNonleaf(NodeReference nxny, NodeReference nxpy, NodeReference pxny,
+                               NodeReference pxpy)
+    {
+        onAllocate();
+        size_t hash = hashNodeNonleaf(nxny, nxpy, pxny, pxpy) % hashPrime;
+        lock_guard<std::mutex> lock(tableLocks[hash]);
+        const NodeType **pnode = &table[hash];
+        const NodeType *node = *pnode;
+
+        while(node != nullptr)
+        {
+            if(node->level > 0 &&
+                    node->nxny.nonleaf == nxny &&
+                    node->nxpy.nonleaf == nxpy &&
+                    node->pxny.nonleaf == pxny &&
+                    node->pxpy.nonleaf == pxpy)
+            {
+                *pnode = node->hashNext;
+                node->hashNext = table[hash];
+                table[hash] = node;
+                return NodeReference(node);
+            }
+
+            pnode = &node->hashNext;
+            node = *pnode;
+        }
+
+        nodeCount++;
+        node = new NodeType((const NodeType *)nxny, (const NodeType *)nxpy, (const NodeType *)pxny, (const NodeType *)pxpy);
+        node->hashNext = table[hash];
+        table[hash] = node;
+        return NodeReference(node);
+    }
+private:
+    vector<vector<NodeReference>> nullNodes;
+    atomic_bool nullNodesLocked;
+public:
+    NodeReference getNullNode(size_t level, CellType backgroundType)
+    {
+        lock(nullNodesLocked);
+        if(backgroundType >= nullNodes.size())
+            nullNodes.resize(backgroundType + 1);
+        if(level < nullNodes[backgroundType].size())
+        {
+            NodeReference retval = nullNodes[backgroundType][level];
+            unlock(nullNodesLocked);
+            return retval;
+        }
+        vector<NodeReference> newNullNodes = nullNodes[backgroundType];
+        unlock(nullNodesLocked);
+        // allocate without holding the lock, since allocating can wait for gc; other threads build the same nodes
+        for(size_t i = newNullNodes.size(); i <= level; i++)
+        {
+            if(i == 0)
+            {
+                newNullNodes.push_back(findOrInsertLeaf(backgroundType, backgroundType, backgroundType, backgroundType));
+            }
+            else
+            {
+                NodeReference prevNullNode = newNullNodes[i - 1];
+                newNullNodes.push_back(findOrInsertNonleaf(prevNullNode, prevNullNode, prevNullNode, prevNullNode));
+            }
+        }
+        NodeReference retval = newNullNodes[level];
+        lock(nullNodesLocked);
+        if(newNullNodes.size() > nullNodes[backgroundType].size())
+            nullNodes[backgroundType] = std::move(newNullNodes);
+        unlock(nullNodesLocked);
+        return retval;
+    }
+    // calls fn for every node in the table while holding off gc, so fn can follow raw pointers from node to node
+    // without holding references, which would keep gc from freeing anything. fn must not build nodes and should
+    // only copy what it needs, since building nodes on other threads can't collect garbage until it returns
+    void forEachNode(function<void(const NodeType *)> fn)
+    {
+        while(runningGC.exchange(true))
+        {
+            std::this_thread::yield();
+        }
+        vector<const NodeType *> nodes;
+        nodes.reserve(nodeCount);
+        for(size_t i = 0; i < hashPrime; i++)
+        {
+            lock_guard<std::mutex> lock(tableLocks[i]);
+            for(const NodeType *node = table[i]; node != nullptr; node = node->hashNext)
+            {
+                nodes.push_back(node);
+            }
+        }
+        for(const NodeType * node : nodes)
+        {
+            fn(node);
+        }
+        runningGC = false;
+    }
+    NodeReference make4x4(CellType n2xn2y, CellType nxn2y, CellType cxn2y, CellType pxn2y,
+                          CellType n2xny, CellType nxny, CellType cxny, CellType pxny,
+                          CellType n2xcy, CellType nxcy, CellType cxcy, CellType pxcy,
+                          CellType n2xpy, CellType nxpy, CellType cxpy, CellType pxpy)
+    {
+        return findOrInsertNonleaf(findOrInsertLeaf(n2xn2y, n2xny, nxn2y, nxny),
+                                findOrInsertLeaf(n2xcy, n2xpy, nxcy, nxpy),
+                                findOrInsertLeaf(cxn2y, cxny, pxn2y, pxny),
+                                findOrInsertLeaf(cxcy, cxpy, pxcy, pxpy));
+    }
+};
+
+
+// marks the current thread as one that builds nodes in gc while other threads might be doing the same :
+// gc only runs once every such thread is stopped at an allocation, so keep the scope short around threads that block on other things
+class MutatorScope
+{
+    MutatorScope(const MutatorScope &) = delete;
+    const MutatorScope &operator =(const MutatorScope &) = delete;
+private:
+    NodeGCHashTable * const gc;
+public:
+    explicit MutatorScope(NodeGCHashTable * gc)
+        : gc(gc)
+    {
+        if(NodeGCHashTable::mutatorScopeDepth++ == 0)
+        {
+            gc->mutatorCount++;
+            gc->safepoint();
+        }
+    }
+    ~MutatorScope()
+    {
+        if(--NodeGCHashTable::mutatorScopeDepth == 0)
+            gc->mutatorCount--;
+    }
+};
+
+CellType getCell(NodeReference rootNode, int64_t x, int64_t y);
+
+// LRU cache of rendered nodes : canonical nodes always render to the same pixels at a given size
+class RenderTileCache
+{
+    RenderTileCache(const RenderTileCache &) = delete;
+    const RenderTileCache &operator =(const RenderTileCache &) = delete;
+public:
+    static constexpr int minTileLogSize = 3;
+    static constexpr int maxTileLogSize = 6;
+private:
+    struct Key
+    {
+        const NodeType * node;
+        int logSize;
+        friend bool operator ==(const Key & a, const Key & b)
+        {
+            return a.node == b.node && a.logSize == b.logSize;
+        }
+    };
+    struct KeyHasher
+    {
+        size_t operator()(const Key & key) const
+        {
+            return std::hash<const NodeType *>()(key.node) + 9 * (size_t)key.logSize;
+        }
+    };
+    struct Entry
+    {
+        Key key;
+        NodeWeakReference node; // detects nodes that were freed and had their address reused
+        shared_ptr<const vector<Color>> pixels;
+    };
+    std::mutex theLock; // tiles are rendered without holding the lock
+    list<Entry> entries; // most recently used first
+    unordered_map<Key, list<Entry>::iterator, KeyHasher> entryMap;
+    const size_t maxPixelCount;
+    size_t pixelCount = 0;
+    shared_ptr<const vector<Color>> get(const NodeType * node, int logSize);
+public:
+    explicit RenderTileCache(size_t maxPixelCount = (size_t)1 << 23)
+        : maxPixelCount(maxPixelCount)
+    {
+    }
+    // draws node with its top left corner at (x, y); the node must be entirely inside the buffer
+    void draw(const NodeType * node, int logSize, int x, int y, void *pixels, int pitch)
+    {
+        shared_ptr<const vector<Color>> tile = get(node, logSize);
+        size_t size = (size_t)1 << logSize;
+        for(size_t row = 0; row < size; row++)
+        {
+            memcpy((char *)pixels + (x * sizeof(Color) + (y + row) * pitch), &(*tile)[row * size], size * sizeof(Color));
+        }
+    }
+};
+
+inline void drawPixel(int64_t x, int64_t y, Color color, void *pixels, int w, int h, int pitch)
+{
+    if(x >= 0 && y >= 0 && x < w && y < h)
+    {
+        *(Color *)((char *)(pixels) + ((size_t)x * sizeof(Color) + (size_t)y * pitch)) = color;
+    }
+}
+
+inline void drawRectangle(int x, int y, int width, int height, Color color, void *pixels, int w, int h, int pitch)
+{
+    int startX = max(0, x), endX = min(w, x + width);
+    int startY = max(0, y), endY = min(h, y + height);
+    if(startX >= endX)
+        return;
+    for(int py = startY; py < endY; py++)
+    {
+        Color *row = (Color *)((char *)pixels + py * pitch);
+        std::fill(row + startX, row + endX, color);
+    }
+}
+
+inline void drawSquare(int64_t x, int64_t y, int64_t size, Color color, void *pixels, int w, int h, int pitch)
+{
+    if(x >= w || y >= h || x + size <= 0 || y + size <= 0)
+        return;
+    int startX = (int)max<int64_t>(x, 0), endX = (int)min<int64_t>(x + size, w);
+    int startY = (int)max<int64_t>(y, 0), endY = (int)min<int64_t>(y + size, h);
+    drawRectangle(startX, startY, endX - startX, endY - startY, color, pixels, w, h, pitch);
+}
+
+// draws node with its top left corner at pixel (x, y) as a 2^logSize pixel square
+void drawNode(NodeReference node, int64_t x, int64_t y, int logSize, void *pixels, int w, int h, int pitch, RenderTileCache *cache = nullptr);
+
+// draws node centered at pixel (centerX, centerY) for any logSize
+void drawCenteredNode(NodeReference node, int64_t centerX, int64_t centerY, int logSize, void *pixels, int w, int h, int pitch, RenderTileCache *cache = nullptr);
+
+// x and y are relative to the top left corner of node; bit level of each picks the child
+NodeReference setCellH(NodeReference node, NodeGCHashTable * gc, uint64_t x, uint64_t y, CellType newCell);
+
+// for nodes too big for 64-bit coordinates
+NodeReference setCellH(NodeReference node, NodeGCHashTable * gc, const BigUnsigned & x, const BigUnsigned & y, CellType newCell);
+
+// node is centered on the origin
+bool isInNodeBounds(NodeReference node, int64_t x, int64_t y);
+
+bool isInNodeBounds(NodeReference node, const BigInteger & x, const BigInteger & y);
+
+// x and y are relative to the top left corner of node
+CellType getCellH(NodeReference node, uint64_t x, uint64_t y);
+
+CellType getCellH(NodeReference node, const BigUnsigned & x, const BigUnsigned & y);
+
+// the number of cells in node that aren't backgroundType; uses the per-node counts for the backgrounds 0 and 1,
+// only walking the nodes whose count doesn't fit in 64 bits, while other backgrounds walk the tree like getCellCounts
+BigUnsigned getPopulation(NodeReference node, CellType backgroundType = 0);
+
+// the number of cells in node in each state, visiting each distinct node once; not cached, so each call walks the tree
+map<CellType, BigUnsigned> getCellCounts(NodeReference node);
+
+// 64-bit cell coordinates offset by 2^63 so that the whole int64_t range is unsigned
+constexpr uint64_t coordinateBias = (uint64_t)1 << 63;
+constexpr size_t maxBiasedNodeLevel = 62; // the biggest nodes that fit in the biased range
+
+struct BiasedRegion // inclusive
+{
+    uint64_t minX, minY, maxX, maxY;
+    bool intersects(uint64_t nodeX, uint64_t nodeY, size_t level) const
+    {
+        uint64_t last = ((uint64_t)2 << level) - 1;
+        return nodeX <= maxX && nodeX + last >= minX && nodeY <= maxY && nodeY + last >= minY;
+    }
+    bool contains(uint64_t nodeX, uint64_t nodeY, size_t level) const
+    {
+        uint64_t last = ((uint64_t)2 << level) - 1;
+        return nodeX >= minX && nodeX + last <= maxX && nodeY >= minY && nodeY + last <= maxY;
+    }
+    bool contains(uint64_t x, uint64_t y) const
+    {
+        return x >= minX && x <= maxX && y >= minY && y <= maxY;
+    }
+};
+
+// the node touching the origin from the (isPX, isPY) side, rebuilt with fn applied down at maxBiasedNodeLevel
+template <typename Fn>
+NodeReference mapBiasedCornerNode(NodeReference node, NodeGCHashTable * gc, bool isPX, bool isPY, Fn & fn)
+{
+    if(node->level <= maxBiasedNodeLevel)
+        return fn(node, isPX ? coordinateBias : 0, isPY ? coordinateBias : 0);
+    NodeReference nxny = node->nxny.nonleaf;
+    NodeReference nxpy = node->nxpy.nonleaf;
+    NodeReference pxny = node->pxny.nonleaf;
+    NodeReference pxpy = node->pxpy.nonleaf;
+    NodeReference & inner = isPX ? (isPY ? nxny : nxpy) : (isPY ? pxny : pxpy);
+    inner = mapBiasedCornerNode(inner, gc, isPX, isPY, fn);
+    return gc->findOrInsertNonleaf(nxny, nxpy, pxny, pxpy);
+}
+
+// rebuilds a node centered on the origin from fn(node, biasedX, biasedY) applied to
+// the nodes that cover the 64-bit coordinate range
+template <typename Fn>
+NodeReference mapBiasedNodes(NodeReference rootNode, NodeGCHashTable * gc, Fn fn)
+{
+    if(rootNode->level <= maxBiasedNodeLevel)
+    {
+        uint64_t position = coordinateBias - ((uint64_t)1 << rootNode->level);
+        return fn(rootNode, position, position);
+    }
+    return gc->findOrInsertNonleaf(mapBiasedCornerNode(rootNode->nxny.nonleaf, gc, false, false, fn),
+                                   mapBiasedCornerNode(rootNode->nxpy.nonleaf, gc, false, true, fn),
+                                   mapBiasedCornerNode(rootNode->pxny.nonleaf, gc, true, false, fn),
+                                   mapBiasedCornerNode(rootNode->pxpy.nonleaf, gc, true, true, fn));
+}
+
+// calls fn(node, biasedX, biasedY) for the nodes of a node centered on the origin that cover the 64-bit coordinate range
+template <typename Fn>
+void visitBiasedNodes(const NodeType * rootNode, Fn fn)
+{
+    if(rootNode->level <= maxBiasedNodeLevel)
+    {
+        uint64_t position = coordinateBias - ((uint64_t)1 << rootNode->level);
+        fn(rootNode, position, position);
+        return;
+    }
+    for(int quadrant = 0; quadrant < 4; quadrant++)
+    {
+        bool isPX = quadrant & 2, isPY = quadrant & 1;
+        const NodeType * node = isPX ? (isPY ? rootNode->pxpy.nonleaf : rootNode->pxny.nonleaf) : (isPY ? rootNode->nxpy.nonleaf : rootNode->nxny.nonleaf);
+        while(node->level > maxBiasedNodeLevel)
+            node = isPX ? (isPY ? node->nxny.nonleaf : node->nxpy.nonleaf) : (isPY ? node->pxny.nonleaf : node->pxpy.nonleaf);
+        fn(node, isPX ? coordinateBias : 0, isPY ? coordinateBias : 0);
+    }
+}
+
+template <typename Cell> // const for sources
+struct CellArrayRegion
+{
+    BiasedRegion region;
+    Cell * cells;
+    size_t stride;
+    Cell * getRow(uint64_t y) const
+    {
+        return cells + (size_t)(y - region.minY) * stride;
+    }
+    void fill(uint64_t minX, uint64_t minY, uint64_t maxX, uint64_t maxY, CellType cell) const
+    {
+        for(uint64_t y = minY; y <= maxY; y++)
+            std::fill_n(getRow(y) + (size_t)(minX - region.minX), (size_t)(maxX - minX + 1), cell);
+    }
+    void set(uint64_t x, uint64_t y, CellType cell) const
+    {
+        getRow(y)[x - region.minX] = cell;
+    }
+    CellType get(uint64_t x, uint64_t y) const
+    {
+        return getRow(y)[x - region.minX];
+    }
+};
+
+// bit x % 8 of byte x / 8 of each row is set for nonzero cells
+template <typename Byte> // const for sources
+struct BitmapRegion
+{
+    BiasedRegion region;
+    Byte * bits;
+    size_t stride;
+    CellType liveCell;
+    Byte * getRow(uint64_t y) const
+    {
+        return bits + (size_t)(y - region.minY) * stride;
+    }
+    void fill(uint64_t minX, uint64_t minY, uint64_t maxX, uint64_t maxY, CellType cell) const
+    {
+        size_t startBit = (size_t)(minX - region.minX), endBit = (size_t)(maxX - region.minX) + 1;
+        size_t startByte = (startBit + 7) / 8, endByte = endBit / 8;
+        for(uint64_t y = minY; y <= maxY; y++)
+        {
+            Byte * row = getRow(y);
+            if(startByte > endByte) // within one byte
+            {
+                for(size_t i = startBit; i < endBit; i++)
+                    setBit(row, i, cell != 0);
+                continue;
+            }
+            for(size_t i = startBit; i < startByte * 8; i++)
+                setBit(row, i, cell != 0);
+            memset(row + startByte, cell != 0 ? 0xFF : 0, endByte - startByte);
+            for(size_t i = endByte * 8; i < endBit; i++)
+                setBit(row, i, cell != 0);
+        }
+    }
+    static void setBit(uint8_t * row, size_t index, bool value)
+    {
+        if(value)
+            row[index / 8] |= (uint8_t)(1 << (index % 8));
+        else
+            row[index / 8] &= (uint8_t)~(1 << (index % 8));
+    }
+    void set(uint64_t x, uint64_t y, CellType cell) const
+    {
+        setBit(getRow(y), (size_t)(x - region.minX), cell != 0);
+    }
+    CellType get(uint64_t x, uint64_t y) const
+    {
+        size_t index = (size_t)(x - region.minX);
+        return (getRow(y)[index / 8] >> (index % 8)) & 1 ? liveCell : 0;
+    }
+};
+
+// copies the cells of node that are in the region to the destination; whole uniform nodes are filled in one go.
+// the destination already holds backgroundType everywhere
+template <typename Destination>
+void getRegionH(const NodeType * node, uint64_t nodeX, uint64_t nodeY, NodeGCHashTable * gc, CellType backgroundType, const Destination & destination)
+{
+    const BiasedRegion & region = destination.region;
+    if(!region.intersects(nodeX, nodeY, node->level))
+        return;
+    if(node == gc->getNullNode(node->level, backgroundType))
+        return;
+    if(node->getPopulation() == 0)
+    {
+        uint64_t last = ((uint64_t)2 << node->level) - 1;
+        destination.fill(max(nodeX, region.minX), max(nodeY, region.minY), min(nodeX + last, region.maxX), min(nodeY + last, region.maxY), 0);
+        return;
+    }
+    if(node->level == 0)
+    {
+        if(region.contains(nodeX, nodeY))
+            destination.set(nodeX, nodeY, node->nxny.leaf);
+        if(region.contains(nodeX, nodeY + 1))
+            destination.set(nodeX, nodeY + 1, node->nxpy.leaf);
+        if(region.contains(nodeX + 1, nodeY))
+            destination.set(nodeX + 1, nodeY, node->pxny.leaf);
+        if(region.contains(nodeX + 1, nodeY + 1))
+            destination.set(nodeX + 1, nodeY + 1, node->pxpy.leaf);
+        return;
+    }
+    uint64_t halfSize = (uint64_t)1 << node->level;
+    getRegionH(node->nxny.nonleaf, nodeX, nodeY, gc, backgroundType, destination);
+    getRegionH(node->nxpy.nonleaf, nodeX, nodeY + halfSize, gc, backgroundType, destination);
+    getRegionH(node->pxny.nonleaf, nodeX + halfSize, nodeY, gc, backgroundType, destination);
+    getRegionH(node->pxpy.nonleaf, nodeX + halfSize, nodeY + halfSize, gc, backgroundType, destination);
+}
+
+// builds the node at (nodeX, nodeY) bottom up from source; the node has to be inside source's region
+template <typename Source>
+NodeReference buildNodeH(size_t level, uint64_t nodeX, uint64_t nodeY, NodeGCHashTable * gc, const Source & source)
+{
+    if(level == 0)
+        return gc->findOrInsertLeaf(source.get(nodeX, nodeY), source.get(nodeX, nodeY + 1), source.get(nodeX + 1, nodeY), source.get(nodeX + 1, nodeY + 1));
+    uint64_t halfSize = (uint64_t)1 << level;
+    return gc->findOrInsertNonleaf(buildNodeH(level - 1, nodeX, nodeY, gc, source),
+                                   buildNodeH(level - 1, nodeX, nodeY + halfSize, gc, source),
+                                   buildNodeH(level - 1, nodeX + halfSize, nodeY, gc, source),
+                                   buildNodeH(level - 1, nodeX + halfSize, nodeY + halfSize, gc, source));
+}
+
+// replaces the cells of node that are in source's region
+template <typename Source>
+NodeReference setRegionH(NodeReference node, uint64_t nodeX, uint64_t nodeY, NodeGCHashTable * gc, const Source & source)
+{
+    const BiasedRegion & region = source.region;
+    if(!region.intersects(nodeX, nodeY, node->level))
+        return node;
+    if(region.contains(nodeX, nodeY, node->level))
+        return buildNodeH(node->level, nodeX, nodeY, gc, source);
+    if(node->level == 0)
+    {
+        CellType nxny = region.contains(nodeX, nodeY) ? source.get(nodeX, nodeY) : node->nxny.leaf;
+        CellType nxpy = region.contains(nodeX, nodeY + 1) ? source.get(nodeX, nodeY + 1) : node->nxpy.leaf;
+        CellType pxny = region.contains(nodeX + 1, nodeY) ? source.get(nodeX + 1, nodeY) : node->pxny.leaf;
+        CellType pxpy = region.contains(nodeX + 1, nodeY + 1) ? source.get(nodeX + 1, nodeY + 1) : node->pxpy.leaf;
+        return gc->findOrInsertLeaf(nxny, nxpy, pxny, pxpy);
+    }
+    uint64_t halfSize = (uint64_t)1 << node->level;
+    return gc->findOrInsertNonleaf(setRegionH(node->nxny.nonleaf, nodeX, nodeY, gc, source),
+                                   setRegionH(node->nxpy.nonleaf, nodeX, nodeY + halfSize, gc, source),
+                                   setRegionH(node->pxny.nonleaf, nodeX + halfSize, nodeY, gc, source),
+                                   setRegionH(node->pxpy.nonleaf, nodeX + halfSize, nodeY + halfSize, gc, source));
+}
+
+template <typename Region>
+struct GetRegionVisitor
+{
+    NodeGCHashTable * gc;
+    CellType backgroundType;
+    const Region & region;
+    void operator ()(const NodeType * node, uint64_t nodeX, uint64_t nodeY) const
+    {
+        getRegionH(node, nodeX, nodeY, gc, backgroundType, region);
+    }
+};
+
+template <typename Region>
+struct SetRegionMapper
+{
+    NodeGCHashTable * gc;
+    const Region & region;
+    NodeReference operator ()(NodeReference node, uint64_t nodeX, uint64_t nodeY) const
+    {
+        return setRegionH(node, nodeX, nodeY, gc, region);
+    }
+};
+
+inline BiasedRegion makeBiasedRegion(int64_t x, int64_t y, uint64_t w, uint64_t h)
+{
+    assert(w > 0 && h > 0);
+    uint64_t minX = (uint64_t)x + coordinateBias, minY = (uint64_t)y + coordinateBias;
+    assert(w - 1 <= ~minX && h - 1 <= ~minY); // must not go past INT64_MAX
+    return BiasedRegion{minX, minY, minX + (w - 1), minY + (h - 1)};
+}
+
+struct WindowKey
+{
+    const NodeType * nxny, * nxpy, * pxny, * pxpy;
+    uint64_t x, y;
+    bool operator ==(const WindowKey & rt) const
+    {
+        return nxny == rt.nxny && nxpy == rt.nxpy && pxny == rt.pxny && pxpy == rt.pxpy && x == rt.x && y == rt.y;
+    }
+};
+
+struct WindowKeyHasher
+{
+    size_t operator ()(const WindowKey & key) const
+    {
+        hash<const void *> pointerHasher;
+        hash<uint64_t> integerHasher;
+        return pointerHasher(key.nxny) + 3 * pointerHasher(key.nxpy) + 5 * pointerHasher(key.pxny) + 7 * pointerHasher(key.pxpy)
+               + 11 * integerHasher(key.x) + 13 * integerHasher(key.y);
+    }
+};
+
+typedef unordered_map<WindowKey, NodeReference, WindowKeyHasher> WindowMemo;
+
+// the node of the same level as nxny, nxpy, pxny and pxpy whose top left corner is at (x, y) in the square they make up.
+// 0 <= x, y <= 2^(level + 1); level must be at most maxBiasedNodeLevel
+NodeReference getWindowNode(NodeGCHashTable * gc, const NodeType * nxny, const NodeType * nxpy, const NodeType * pxny, const NodeType * pxpy, uint64_t x, uint64_t y, WindowMemo & memo);
+
+// replaces the node of newNode's level at (x, y) relative to the top left corner of node; x and y must be multiples of newNode's size
+NodeReference setNodeH(NodeReference node, NodeGCHashTable * gc, const BigUnsigned & x, const BigUnsigned & y, NodeReference newNode);
+
+struct CellBounds // inclusive
+{
+    bool empty;
+    int64_t minX, minY, maxX, maxY;
+};
+
+struct GameState
+{
+    NodeGCHashTable * gc;
+    NodeReference rootNode;
+    CellType backgroundType;
+    BigUnsigned generation;
+    const Rule * rule;
+    // rule defaults to Life
+    GameState(NodeGCHashTable * gc, NodeReference rootNode = nullptr, CellType backgroundType = 0, BigUnsigned generation = BigUnsigned(), const Rule * rule = nullptr)
+        : gc(gc), rootNode(rootNode), backgroundType(backgroundType), generation(generation), rule(rule)
+    {
+        if(gc == nullptr)
+        {
+            this->rootNode = nullptr;
+            this->backgroundType = 0;
+            this->generation = BigUnsigned();
+            this->rule = nullptr;
+            return;
+        }
+        if(rule == nullptr)
+            this->rule = Rule::getLife();
+        if(rootNode == nullptr)
+            this->rootNode = gc->getNullNode(0, backgroundType);
+        assert(this->rootNode != nullptr);
+    }
+    void draw(int logSize, void *pixels, int w, int h, int pitch, RenderTileCache *cache = nullptr, ThreadPool *threadPool = nullptr) const
+    {
+        assert(gc != nullptr);
+        Color backgroundColor = getCellColorDescriptorColor(getCellColorDescriptor(backgroundType));
+        if(threadPool == nullptr)
+        {
+            drawRectangle(0, 0, w, h, backgroundColor, pixels, w, h, pitch);
+            drawCenteredNode(rootNode, w / 2, h / 2, logSize + 1, pixels, w, h, pitch, cache);
+            return;
+        }
+        // the tile grid is aligned with the node grid so that cached nodes aren't split between tiles
+        constexpr int tileSize = 1 << (RenderTileCache::maxTileLogSize + 1);
+        int firstTileX = (w / 2) % tileSize, firstTileY = (h / 2) % tileSize;
+        if(firstTileX > 0)
+            firstTileX -= tileSize;
+        if(firstTileY > 0)
+            firstTileY -= tileSize;
+        size_t xTileCount = (w - firstTileX + tileSize - 1) / tileSize;
+        size_t yTileCount = (h - firstTileY + tileSize - 1) / tileSize;
+        threadPool->parallelFor(xTileCount * yTileCount, [&](size_t tileIndex)
+        {
+            int startX = max(0, firstTileX + (int)(tileIndex % xTileCount) * tileSize);
+            int startY = max(0, firstTileY + (int)(tileIndex / xTileCount) * tileSize);
+            int endX = min(w, firstTileX + (int)(tileIndex % xTileCount + 1) * tileSize);
+            int endY = min(h, firstTileY + (int)(tileIndex / xTileCount + 1) * tileSize);
+            void *tilePixels = (char *)pixels + (startX * sizeof(Color) + startY * pitch);
+            drawRectangle(0, 0, endX - startX, endY - startY, backgroundColor, tilePixels, endX - startX, endY - startY, pitch);
+            drawCenteredNode(rootNode, w / 2 - startX, h / 2 - startY, logSize + 1, tilePixels, endX - startX, endY - startY, pitch, cache);
+        });
+    }
+    // like draw, but at a fixed scale of 2^logCellSize pixels per cell (negative to shrink) with the cell (centerX, centerY)
+    // at the center, so a sequence of frames doesn't zoom as the root grows
+    void drawView(int logCellSize, int64_t centerX, int64_t centerY, void *pixels, int w, int h, int pitch, RenderTileCache *cache = nullptr) const
+    {
+        assert(gc != nullptr);
+        constexpr int64_t maxOffset = (int64_t)1 << 60; // keeps the root's children too big to miss the buffer, see drawCornerNode
+        Color backgroundColor = getCellColorDescriptorColor(getCellColorDescriptor(backgroundType));
+        drawRectangle(0, 0, w, h, backgroundColor, pixels, w, h, pitch);
+        auto toPixels = [&](int64_t cellOffset) -> int64_t
+        {
+            if(logCellSize < 0)
+                return cellOffset >> min(63, -logCellSize);
+            if(cellOffset > (maxOffset >> logCellSize))
+                return maxOffset;
+            if(cellOffset < -(maxOffset >> logCellSize))
+                return -maxOffset;
+            return cellOffset << logCellSize;
+        };
+        int logSize = max(0, (int)rootNode->level + 1 + logCellSize);
+        drawCenteredNode(rootNode, w / 2 - toPixels(centerX), h / 2 - toPixels(centerY), logSize, pixels, w, h, pitch, cache);
+    }
+private:
+    void expandRoot()
+    {
+        assert(gc != nullptr);
+        if(rootNode->level == 0)
+        {
+            rootNode = gc->findOrInsertNonleaf(gc->findOrInsertLeaf(backgroundType, backgroundType, backgroundType, rootNode->nxny.leaf),
+                                    gc->findOrInsertLeaf(backgroundType, backgroundType, rootNode->nxpy.leaf, backgroundType),
+                                    gc->findOrInsertLeaf(backgroundType, rootNode->pxny.leaf, backgroundType, backgroundType),
+                                    gc->findOrInsertLeaf(rootNode->pxpy.leaf, backgroundType, backgroundType, backgroundType));
+        }
+        else
+        {
+            NodeReference nullNode = gc->getNullNode(rootNode->level - 1, backgroundType);
+            rootNode = gc->findOrInsertNonleaf(gc->findOrInsertNonleaf(nullNode, nullNode, nullNode, rootNode->nxny.nonleaf),
+                                    gc->findOrInsertNonleaf(nullNode, nullNode, rootNode->nxpy.nonleaf, nullNode),
+                                    gc->findOrInsertNonleaf(nullNode, rootNode->pxny.nonleaf, nullNode, nullNode),
+                                    gc->findOrInsertNonleaf(rootNode->pxpy.nonleaf, nullNode, nullNode, nullNode));
+        }
+    }
+public:
+    // the root is centered on the origin, so it spans -2^level to 2^level - 1
+    void setCell(int64_t x, int64_t y, CellType newCell)
+    {
+        assert(gc != nullptr);
+        while(!isInNodeBounds(rootNode, x, y))
+        {
+            expandRoot();
+        }
+        if(rootNode->level >= 64)
+        {
+            setCell(BigInteger(x), BigInteger(y), newCell);
+            return;
+        }
+        uint64_t rootHalfSize = (uint64_t)1 << rootNode->level;
+        rootNode = setCellH(rootNode, gc, (uint64_t)x + rootHalfSize, (uint64_t)y + rootHalfSize, newCell);
+    }
+    void setCell(const BigInteger & x, const BigInteger & y, CellType newCell)
+    {
+        assert(gc != nullptr);
+        while(!isInNodeBounds(rootNode, x, y))
+        {
+            expandRoot();
+        }
+        BigInteger rootHalfSize = BigInteger(BigUnsigned(1) << rootNode->level);
+        rootNode = setCellH(rootNode, gc, (x + rootHalfSize).getMagnitude(), (y + rootHalfSize).getMagnitude(), newCell);
+    }
+    CellType getCell(int64_t x, int64_t y) const
+    {
+        assert(gc != nullptr);
+        if(!isInNodeBounds(rootNode, x, y))
+            return backgroundType;
+        if(rootNode->level >= 64)
+            return getCell(BigInteger(x), BigInteger(y));
+        uint64_t rootHalfSize = (uint64_t)1 << rootNode->level;
+        return getCellH(rootNode, (uint64_t)x + rootHalfSize, (uint64_t)y + rootHalfSize);
+    }
+    CellType getCell(const BigInteger & x, const BigInteger & y) const
+    {
+        assert(gc != nullptr);
+        if(!isInNodeBounds(rootNode, x, y))
+            return backgroundType;
+        BigInteger rootHalfSize = BigInteger(BigUnsigned(1) << rootNode->level);
+        return getCellH(rootNode, (x + rootHalfSize).getMagnitude(), (y + rootHalfSize).getMagnitude());
+    }
+    // copies the w by h cells with the top left corner at (x, y) into cells, with stride elements from one row to the next.
+    // visits the tree once, filling uniform subtrees without descending into them
+    void getRegion(int64_t x, int64_t y, uint64_t w, uint64_t h, CellType * cells, size_t stride) const
+    {
+        assert(gc != nullptr);
+        if(w == 0 || h == 0)
+            return;
+        CellArrayRegion<CellType> destination{makeBiasedRegion(x, y, w, h), cells, stride};
+        destination.fill(destination.region.minX, destination.region.minY, destination.region.maxX, destination.region.maxY, backgroundType);
+        visitBiasedNodes(rootNode, GetRegionVisitor<CellArrayRegion<CellType>>{gc, backgroundType, destination});
+    }
+    // like getRegion but into a packed bitmap : bit x % 8 of byte x / 8 of each row is set for nonzero cells
+    void getRegionBitmap(int64_t x, int64_t y, uint64_t w, uint64_t h, uint8_t * bits, size_t stride) const
+    {
+        assert(gc != nullptr);
+        if(w == 0 || h == 0)
+            return;
+        BitmapRegion<uint8_t> destination{makeBiasedRegion(x, y, w, h), bits, stride, 1};
+        destination.fill(destination.region.minX, destination.region.minY, destination.region.maxX, destination.region.maxY, backgroundType);
+        visitBiasedNodes(rootNode, GetRegionVisitor<BitmapRegion<uint8_t>>{gc, backgroundType, destination});
+    }
+private:
+    template <typename Source>
+    void setRegion(const Source & source)
+    {
+        const BiasedRegion & region = source.region;
+        while(!isInNodeBounds(rootNode, (int64_t)(region.minX - coordinateBias), (int64_t)(region.minY - coordinateBias))
+                || !isInNodeBounds(rootNode, (int64_t)(region.maxX - coordinateBias), (int64_t)(region.maxY - coordinateBias)))
+        {
+            expandRoot();
+        }
+        rootNode = mapBiasedNodes(rootNode, gc, SetRegionMapper<Source>{gc, source});
+    }
+public:
+    // replaces the w by h cells with the top left corner at (x, y) with cells, laid out as for getRegion.
+    // nodes entirely inside the rectangle are built bottom up instead of being edited a cell at a time
+    void setRegion(int64_t x, int64_t y, uint64_t w, uint64_t h, const CellType * cells, size_t stride)
+    {
+        assert(gc != nullptr);
+        if(w == 0 || h == 0)
+            return;
+        setRegion(CellArrayRegion<const CellType>{makeBiasedRegion(x, y, w, h), cells, stride});
+    }
+    // like setRegion but from a packed bitmap laid out as for getRegionBitmap; set bits become liveCell
+    void setRegionBitmap(int64_t x, int64_t y, uint64_t w, uint64_t h, const uint8_t * bits, size_t stride, CellType liveCell = 1)
+    {
+        assert(gc != nullptr);
+        if(w == 0 || h == 0)
+            return;
+        setRegion(BitmapRegion<const uint8_t>{makeBiasedRegion(x, y, w, h), bits, stride, liveCell});
+    }
+    // the bounds of the nonzero cells from the cached node extents.
+    // returns false if the root is too big for 64-bit coordinates
+    bool getBounds(CellBounds & bounds) const
+    {
+        assert(gc != nullptr);
+        if(rootNode->level > NodeType::maxExtentLevel)
+            return false;
+        NodeType::Extent extent = rootNode->getExtent();
+        bounds.empty = extent.empty();
+        if(bounds.empty)
+        {
+            bounds.minX = bounds.minY = bounds.maxX = bounds.maxY = 0;
+            return true;
+        }
+        uint64_t rootHalfSize = (uint64_t)1 << rootNode->level;
+        bounds.minX = (int64_t)(extent.minX - rootHalfSize);
+        bounds.minY = (int64_t)(extent.minY - rootHalfSize);
+        bounds.maxX = (int64_t)(extent.maxX - rootHalfSize);
+        bounds.maxY = (int64_t)(extent.maxY - rootHalfSize);
+        return true;
+    }
+private:
+    // the smallest level whose node around the origin holds everything within radius of the origin
+    static size_t getCoveringLevel(uint64_t radius)
+    {
+        if(radius > ((uint64_t)1 << 63))
+            return 64;
+        size_t level = 0;
+        while(((uint64_t)1 << level) < radius)
+            level++;
+        return level;
+    }
+    // the distance from the origin that the nonzero cells reach
+    static uint64_t getRadius(const CellBounds & bounds)
+    {
+        assert(!bounds.empty);
+        uint64_t retval = 0;
+        for(int64_t minValue : {bounds.minX, bounds.minY})
+        {
+            if(minValue < 0)
+                retval = max(retval, -(uint64_t)minValue);
+        }
+        for(int64_t maxValue : {bounds.maxX, bounds.maxY})
+        {
+            if(maxValue >= 0)
+                retval = max(retval, (uint64_t)maxValue + 1);
+        }
+        return retval;
+    }
+    // every cell outside of the new root must be background
+    void setRootLevel(size_t level)
+    {
+        while(rootNode->level < level)
+            expandRoot();
+        while(rootNode->level > level)
+            rootNode = rootNode->getCenter(gc);
+    }
+    void checkForContractRoot()
+    {
+        assert(gc != nullptr);
+        CellBounds bounds;
+        if(backgroundType == 0 && getBounds(bounds))
+        {
+            setRootLevel(bounds.empty ? 1 : max<size_t>(1, getCoveringLevel(getRadius(bounds))));
+            return;
+        }
+        for(;;)
+        {
+            if(rootNode->level < 2)
+            {
+                return;
+            }
+            NodeReference nullNode = gc->getNullNode(rootNode->level - 2, backgroundType);
+            if(rootNode->nxny.nonleaf->nxny.nonleaf != nullNode)
+                return;
+            if(rootNode->nxny.nonleaf->nxpy.nonleaf != nullNode)
+                return;
+            if(rootNode->nxny.nonleaf->pxny.nonleaf != nullNode)
+                return;
+            if(rootNode->nxpy.nonleaf->nxny.nonleaf != nullNode)
+                return;
+            if(rootNode->nxpy.nonleaf->nxpy.nonleaf != nullNode)
+                return;
+            if(rootNode->nxpy.nonleaf->pxpy.nonleaf != nullNode)
+                return;
+            if(rootNode->pxny.nonleaf->nxny.nonleaf != nullNode)
+                return;
+            if(rootNode->pxny.nonleaf->pxny.nonleaf != nullNode)
+                return;
+            if(rootNode->pxny.nonleaf->pxpy.nonleaf != nullNode)
+                return;
+            if(rootNode->pxpy.nonleaf->nxpy.nonleaf != nullNode)
+                return;
+            if(rootNode->pxpy.nonleaf->pxny.nonleaf != nullNode)
+                return;
+            if(rootNode->pxpy.nonleaf->pxpy.nonleaf != nullNode)
+                return;
+            rootNode = rootNode->getCenter(gc);
+        }
+    }
+public:
+    // returns false and leaves the state unchanged if cancelled through control
+    bool step(size_t logStepSize, StepControl *control = nullptr)
+    {
+        assert(gc != nullptr);
+        NodeReference originalRootNode = rootNode;
+        CellBounds bounds;
+        if(backgroundType == 0 && getBounds(bounds))
+        {
+            // the result is the center of the root, so it has to hold everything
+            // the pattern can reach in 2^logStepSize generations at one cell per generation
+            size_t resultLevel = logStepSize;
+            if(!bounds.empty)
+            {
+                if(logStepSize >= 63)
+                    resultLevel = logStepSize + 1; // the radius is at most 2^63
+                else
+                    resultLevel = max(resultLevel, getCoveringLevel(getRadius(bounds) + ((uint64_t)1 << logStepSize)));
+            }
+            setRootLevel(resultLevel + 1);
+        }
+        else
+        {
+            expandRoot();
+            expandRoot();
+            while(rootNode->level < logStepSize + 2)
+                expandRoot();
+        }
+        if(control != nullptr)
+            control->start(rootNode->level);
+        NodeReference newRootNode = rootNode->getNextState(gc, rule, logStepSize, control);
+        if(newRootNode == nullptr)
+        {
+            rootNode = originalRootNode;
+            return false;
+        }
+        NodeReference nextBackground = gc->getNullNode(rootNode->level, backgroundType)->getNextState(gc, rule, logStepSize);
+        while(nextBackground->level > 0) // null nodes are uniform, so any cell will do
+            nextBackground = nextBackground->nxny.nonleaf;
+        backgroundType = nextBackground->nxny.leaf;
+        rootNode = newRootNode;
+        generation += BigUnsigned(1) << logStepSize;
+        checkForContractRoot();
+        return true;
+    }
+    // advances by generationCount generations using one power of two step per set bit,
+    // smallest first so the small steps run while the pattern (and so the root) is smallest.
+    // returns false and leaves the state unchanged if cancelled through control
+    bool advance(const BigUnsigned & generationCount, StepControl *control = nullptr)
+    {
+        assert(gc != nullptr);
+        GameState originalState = *this;
+        size_t bitCount = generationCount.bitLength();
+        for(size_t logStepSize = 0; logStepSize < bitCount; logStepSize++)
+        {
+            if(!generationCount.getBit(logStepSize))
+                continue;
+            if(!step(logStepSize, control))
+            {
+                *this = originalState;
+                return false;
+            }
+        }
+        return true;
+    }
+    // the number of cells in the root node that aren't background. only a cache lookup when the background is 0 or 1
+    // and the count fits in 64 bits; past that it adds up the counts of the uppermost nodes that fit on every call,
+    // and other backgrounds walk the whole tree
+    BigUnsigned population() const
+    {
+        assert(gc != nullptr);
+        return getPopulation(rootNode, backgroundType);
+    }
+    // the number of cells in the root node in each state; walks the tree on every call
+    map<CellType, BigUnsigned> populationByState() const
+    {
+        assert(gc != nullptr);
+        return getCellCounts(rootNode);
+    }
+    // the smallest node holding every nonzero cell, with the top left corner of the bounds at its top left corner,
+    // so translated copies of a pattern give the same node. built by hash-consing shifted copies of the live nodes,
+    // so the cost follows the live part of the tree. returns nullptr for a nonzero background or a root too big for getBounds
+    NodeReference getPatternNode() const
+    {
+        assert(gc != nullptr);
+        CellBounds bounds;
+        if(backgroundType != 0 || !getBounds(bounds))
+            return nullptr;
+        if(bounds.empty)
+            return gc->getNullNode(0, 0);
+        uint64_t size = max<uint64_t>((uint64_t)(bounds.maxX - bounds.minX), (uint64_t)(bounds.maxY - bounds.minY)) + 1;
+        size_t level = 0;
+        while(((uint64_t)2 << level) < size)
+            level++;
+        uint64_t rootHalfSize = (uint64_t)1 << rootNode->level;
+        NodeReference nullNode = gc->getNullNode(rootNode->level, 0);
+        WindowMemo memo;
+        NodeReference retval = getWindowNode(gc, rootNode, nullNode, nullNode, nullNode, (uint64_t)bounds.minX + rootHalfSize, (uint64_t)bounds.minY + rootHalfSize, memo);
+        while(retval->level > level)
+            retval = retval->nxny.nonleaf;
+        return retval;
+    }
+private:
+    // puts node with its top left corner at (x, y), replacing what was there
+    void setNode(NodeReference node, const BigInteger & x, const BigInteger & y)
+    {
+        assert(node->level < maxBiasedNodeLevel);
+        size_t logSize = node->level + 1;
+        uint64_t size = (uint64_t)1 << logSize;
+        // the shifted node below covers twice the size
+        while(!isInNodeBounds(rootNode, x, y) || !isInNodeBounds(rootNode, x + BigInteger(2 * size - 1), y + BigInteger(2 * size - 1)))
+        {
+            expandRoot();
+        }
+        BigInteger rootHalfSize = BigInteger(BigUnsigned(1) << rootNode->level);
+        BigUnsigned nodeX = (x + rootHalfSize).getMagnitude(), nodeY = (y + rootHalfSize).getMagnitude();
+        BigUnsigned alignedX = (nodeX >> logSize) << logSize, alignedY = (nodeY >> logSize) << logSize;
+        uint64_t offsetX = (nodeX - alignedX).toUInt64(), offsetY = (nodeY - alignedY).toUInt64();
+        if(offsetX == 0 && offsetY == 0)
+        {
+            rootNode = setNodeH(rootNode, gc, alignedX, alignedY, node);
+            return;
+        }
+        // shift node by the offset inside a node twice its size, then put that node's quarters in the aligned places they cover
+        NodeReference nullNode = gc->getNullNode(node->level, backgroundType);
+        NodeReference biggerNullNode = gc->getNullNode(node->level + 1, backgroundType);
+        NodeReference cornerNode = gc->findOrInsertNonleaf(nullNode, nullNode, nullNode, node);
+        WindowMemo memo;
+        NodeReference shiftedNode = getWindowNode(gc, cornerNode, biggerNullNode, biggerNullNode, biggerNullNode, size - offsetX, size - offsetY, memo);
+        rootNode = setNodeH(rootNode, gc, alignedX, alignedY, shiftedNode->nxny.nonleaf);
+        rootNode = setNodeH(rootNode, gc, alignedX, alignedY + BigUnsigned(size), shiftedNode->nxpy.nonleaf);
+        rootNode = setNodeH(rootNode, gc, alignedX + BigUnsigned(size), alignedY, shiftedNode->pxny.nonleaf);
+        rootNode = setNodeH(rootNode, gc, alignedX + BigUnsigned(size), alignedY + BigUnsigned(size), shiftedNode->pxpy.nonleaf);
+    }
+public:
+    // the same pattern moved by (dx, dy), built from getPatternNode instead of cell by cell.
+    // returns a null GameState if the pattern can't be moved (see getPatternNode)
+    GameState translated(const BigInteger & dx, const BigInteger & dy) const
+    {
+        assert(gc != nullptr);
+        if(dx.isZero() && dy.isZero())
+            return *this;
+        CellBounds bounds;
+        NodeReference patternNode = getPatternNode();
+        if(patternNode == nullptr || patternNode->level >= maxBiasedNodeLevel || !getBounds(bounds))
+            return GameState(nullptr);
+        if(bounds.empty)
+            return *this;
+        GameState retval(gc, nullptr, 0, generation, rule);
+        retval.setNode(patternNode, BigInteger(bounds.minX) + dx, BigInteger(bounds.minY) + dy);
+        retval.checkForContractRoot();
+        return retval;
+    }
+    // the root grown to level by surrounding it with background, for comparing with states that have bigger roots
+    NodeReference getExpandedRootNode(size_t level) const
+    {
+        assert(gc != nullptr && level >= rootNode->level);
+        GameState expanded = *this;
+        expanded.setRootLevel(level);
+        return expanded.rootNode;
+    }
+    operator bool() const
+    {
+        return gc != nullptr;
+    }
+    bool operator !() const
+    {
+        return gc == nullptr;
+    }
+};
+
+struct ChangedCell
+{
+    int64_t x, y;
+    CellType oldCell, newCell;
+};
+
+struct ChangedSquare // aligned to its size
+{
+    int64_t x, y;
+    uint64_t size;
+};
+
+// the differences between two states in the same node table, found by walking both trees together and skipping
+// every pair of identical (hash-consed) subtrees, so the cost follows what changed and not the size of the pattern.
+// the cells are appended in Morton (Z) order. returns false if the backgrounds differ (so every cell outside the roots changed)
+// or if either root is too big for 64-bit coordinates
+bool diffStates(const GameState & oldState, const GameState & newState, vector<ChangedCell> & changedCells);
+
+// like above, but appends each 2^logSize square with changed cells instead of the cells.
+// also returns false if logSize is over maxBiasedNodeLevel, since the roots are expanded to hold whole aligned squares
+bool diffStates(const GameState & oldState, const GameState & newState, size_t logSize, vector<ChangedSquare> & changedSquares);
+
+// visits the cells that differ from the background, either in the quadtree's Morton (Z) order
+// or row by row, never descending into background subtrees, so the cost follows the live cells and not the area
+class LiveCellIterator
+{
+public:
+    enum class Order
+    {
+        Morton,
+        RowMajor
+    };
+private:
+    struct MortonFrame
+    {
+        const NodeType * node;
+        uint64_t x, y; // biased
+        int nextChild;
+    };
+    struct BandNode
+    {
+        const NodeType * node;
+        uint64_t x; // biased
+    };
+    struct Band // nodes of one level side by side, ordered by x
+    {
+        vector<BandNode> nodes;
+        size_t level;
+        uint64_t y; // biased
+    };
+    struct Cell
+    {
+        uint64_t x, y; // biased
+        CellType cell;
+    };
+    NodeReference rootNode; // keeps the tree alive
+    CellType backgroundType;
+    Order order;
+    BiasedRegion region;
+    vector<const NodeType *> nullNodes; // indexed by level
+    vector<MortonFrame> mortonStack;
+    vector<Band> bandStack; // the next band is on top
+    vector<Cell> rowCells; // cells of the current band of leaves
+    size_t rowCellIndex = 0;
+    Cell current;
+    bool isLive(const NodeType * node, uint64_t x, uint64_t y) const
+    {
+        return node != nullNodes[node->level] && region.intersects(x, y, node->level);
+    }
+    void addCell(uint64_t x, uint64_t y, CellType cell)
+    {
+        if(cell != backgroundType && region.contains(x, y))
+            rowCells.push_back(Cell{x, y, cell});
+    }
+    void init(const GameState & gs)
+    {
+        assert(gs);
+        for(size_t level = 0; level <= rootNode->level; level++)
+            nullNodes.push_back(gs.gc->getNullNode(level, backgroundType));
+        vector<MortonFrame> startNodes; // at most 4 nodes tiling the 64-bit range
+        visitBiasedNodes(rootNode, [&](const NodeType * node, uint64_t x, uint64_t y)
+        {
+            if(isLive(node, x, y))
+                startNodes.push_back(MortonFrame{node, x, y, 0});
+        });
+        sort(startNodes.begin(), startNodes.end(), [](const MortonFrame & a, const MortonFrame & b)
+        {
+            return a.y != b.y ? a.y < b.y : a.x < b.x;
+        });
+        if(order == Order::Morton)
+        {
+            mortonStack.assign(startNodes.rbegin(), startNodes.rend());
+            return;
+        }
+        for(auto i = startNodes.rbegin(); i != startNodes.rend(); ++i)
+        {
+            if(bandStack.empty() || bandStack.back().y != i->y)
+                bandStack.push_back(Band{vector<BandNode>(), i->node->level, i->y});
+            bandStack.back().nodes.insert(bandStack.back().nodes.begin(), BandNode{i->node, i->x});
+        }
+    }
+    bool nextMorton()
+    {
+        while(!mortonStack.empty())
+        {
+            MortonFrame & frame = mortonStack.back();
+            if(frame.nextChild == 4)
+            {
+                mortonStack.pop_back();
+                continue;
+            }
+            int child = frame.nextChild++;
+            bool isPX = child & 1, isPY = child & 2;
+            const NodeType * node = frame.node;
+            if(node->level == 0)
+            {
+                CellType cell = isPX ? (isPY ? node->pxpy.leaf : node->pxny.leaf) : (isPY ? node->nxpy.leaf : node->nxny.leaf);
+                uint64_t x = frame.x + (isPX ? 1 : 0), y = frame.y + (isPY ? 1 : 0);
+                if(cell != backgroundType && region.contains(x, y))
+                {
+                    current = Cell{x, y, cell};
+                    return true;
+                }
+                continue;
+            }
+            uint64_t halfSize = (uint64_t)1 << node->level;
+            const NodeType * childNode = isPX ? (isPY ? node->pxpy.nonleaf : node->pxny.nonleaf) : (isPY ? node->nxpy.nonleaf : node->nxny.nonleaf);
+            uint64_t x = frame.x + (isPX ? halfSize : 0), y = frame.y + (isPY ? halfSize : 0);
+            if(isLive(childNode, x, y))
+                mortonStack.push_back(MortonFrame{childNode, x, y, 0});
+        }
+        return false;
+    }
+    bool nextRowMajor()
+    {
+        for(;;)
+        {
+            if(rowCellIndex < rowCells.size())
+            {
+                current = rowCells[rowCellIndex++];
+                return true;
+            }
+            if(bandStack.empty())
+                return false;
+            Band band = std::move(bandStack.back());
+            bandStack.pop_back();
+            if(band.level == 0)
+            {
+                // both rows of the leaves, top row first
+                rowCells.clear();
+                rowCellIndex = 0;
+                for(const BandNode & bandNode : band.nodes)
+                {
+                    addCell(bandNode.x, band.y, bandNode.node->nxny.leaf);
+                    addCell(bandNode.x + 1, band.y, bandNode.node->pxny.leaf);
+                }
+                for(const BandNode & bandNode : band.nodes)
+                {
+                    addCell(bandNode.x, band.y + 1, bandNode.node->nxpy.leaf);
+                    addCell(bandNode.x + 1, band.y + 1, bandNode.node->pxpy.leaf);
+                }
+                continue;
+            }
+            uint64_t halfSize = (uint64_t)1 << band.level;
+            Band top{vector<BandNode>(), band.level - 1, band.y};
+            Band bottom{vector<BandNode>(), band.level - 1, band.y + halfSize};
+            for(const BandNode & bandNode : band.nodes)
+            {
+                const NodeType * node = bandNode.node;
+                if(isLive(node->nxny.nonleaf, bandNode.x, top.y))
+                    top.nodes.push_back(BandNode{node->nxny.nonleaf, bandNode.x});
+                if(isLive(node->pxny.nonleaf, bandNode.x + halfSize, top.y))
+                    top.nodes.push_back(BandNode{node->pxny.nonleaf, bandNode.x + halfSize});
+                if(isLive(node->nxpy.nonleaf, bandNode.x, bottom.y))
+                    bottom.nodes.push_back(BandNode{node->nxpy.nonleaf, bandNode.x});
+                if(isLive(node->pxpy.nonleaf, bandNode.x + halfSize, bottom.y))
+                    bottom.nodes.push_back(BandNode{node->pxpy.nonleaf, bandNode.x + halfSize});
+            }
+            if(!bottom.nodes.empty())
+                bandStack.push_back(std::move(bottom));
+            if(!top.nodes.empty())
+                bandStack.push_back(std::move(top));
+        }
+    }
+public:
+    // every live cell in the 64-bit coordinate range
+    explicit LiveCellIterator(const GameState & gs, Order order = Order::Morton)
+        : rootNode(gs.rootNode), backgroundType(gs.backgroundType), order(order), region{0, 0, ~(uint64_t)0, ~(uint64_t)0}
+    {
+        init(gs);
+    }
+    // the live cells in the w by h rectangle with the top left corner at (x, y)
+    LiveCellIterator(const GameState & gs, int64_t x, int64_t y, uint64_t w, uint64_t h, Order order = Order::Morton)
+        : rootNode(gs.rootNode), backgroundType(gs.backgroundType), order(order), region{0, 0, 0, 0}
+    {
+        if(w == 0 || h == 0)
+            return;
+        region = makeBiasedRegion(x, y, w, h);
+        init(gs);
+    }
+    // moves to the next live cell; returns false when there are no more
+    bool next()
+    {
+        if(order == Order::Morton)
+            return nextMorton();
+        return nextRowMajor();
+    }
+    int64_t getX() const
+    {
+        return (int64_t)(current.x - coordinateBias);
+    }
+    int64_t getY() const
+    {
+        return (int64_t)(current.y - coordinateBias);
+    }
+    CellType getCell() const
+    {
+        return current.cell;
+    }
+};
+
+// finds the period and displacement of an oscillator or spaceship from the states it is shown, one hash table lookup each :
+// equal patterns at the same level are the same hash-consed node, so oscillators repeat their root node
+// and spaceships repeat the node from GameState::getPatternNode at a different position.
+// once found, jump goes any number of generations ahead by stepping only the remainder modulo the period
+class PeriodDetector
+{
+private:
+    struct Sighting
+    {
+        NodeWeakReference node; // detects nodes that were freed and had their address reused, without keeping them from gc
+        BigUnsigned generation;
+        int64_t x, y; // the top left corner of the bounds, for pattern nodes
+    };
+    struct SightingKey
+    {
+        const NodeType * node;
+        CellType backgroundType;
+        bool isPatternNode; // otherwise a root node
+        bool operator ==(const SightingKey & rt) const
+        {
+            return node == rt.node && backgroundType == rt.backgroundType && isPatternNode == rt.isPatternNode;
+        }
+    };
+    struct SightingKeyHasher
+    {
+        size_t operator ()(const SightingKey & key) const
+        {
+            return hash<const void *>()(key.node) + 3 * (size_t)key.backgroundType + (key.isPatternNode ? 7 : 0);
+        }
+    };
+    const size_t maxSightingCount;
+    unordered_map<SightingKey, Sighting, SightingKeyHasher> sightings;
+    deque<SightingKey> sightingOrder; // oldest first
+    bool periodFound = false;
+    BigUnsigned period;
+    BigInteger displacementX, displacementY;
+    // returns true if node was seen before at an earlier generation
+    bool check(const SightingKey & key, Sighting sighting)
+    {
+        auto iter = sightings.find(key);
+        if(iter != sightings.end() && iter->second.node.get() == nullptr)
+        {
+            // the node seen before was freed, so this is a different node at the same address; it takes the old one's
+            // place, including its place in sightingOrder
+            iter->second = std::move(sighting);
+            return false;
+        }
+        if(iter != sightings.end())
+        {
+            if(iter->second.generation >= sighting.generation)
+                return false;
+            periodFound = true;
+            period = sighting.generation - iter->second.generation;
+            displacementX = BigInteger(sighting.x) - BigInteger(iter->second.x);
+            displacementY = BigInteger(sighting.y) - BigInteger(iter->second.y);
+            return true;
+        }
+        sightings.emplace(key, std::move(sighting));
+        sightingOrder.push_back(key);
+        if(sightingOrder.size() > maxSightingCount)
+        {
+            sightings.erase(sightingOrder.front());
+            sightingOrder.pop_front();
+        }
+        return false;
+    }
+public:
+    // remembers the last maxSightingCount nodes, so a cycle is found if it is at most about half that many observed states long.
+    // the nodes are only weakly referenced, so gc can free them; a cycle through a freed node is found one cycle later
+    explicit PeriodDetector(size_t maxSightingCount = 1 << 16)
+        : maxSightingCount(maxSightingCount)
+    {
+    }
+    // observe the states in order of increasing generation; with a step size bigger than 1,
+    // the period found is the first multiple of the step size that the pattern repeats after.
+    // returns true once the period is found
+    bool observe(const GameState & gs)
+    {
+        assert(gs);
+        if(periodFound)
+            return true;
+        if(check(SightingKey{gs.rootNode, gs.backgroundType, false}, Sighting{gs.rootNode, gs.generation, 0, 0}))
+            return true;
+        NodeReference patternNode = gs.getPatternNode();
+        CellBounds bounds;
+        if(patternNode == nullptr || !gs.getBounds(bounds))
+            return false;
+        return check(SightingKey{patternNode, 0, true}, Sighting{patternNode, gs.generation, bounds.minX, bounds.minY});
+    }
+    bool found() const
+    {
+        return periodFound;
+    }
+    const BigUnsigned & getPeriod() const
+    {
+        assert(periodFound);
+        return period;
+    }
+    // how far the pattern moves each period
+    const BigInteger & getDisplacementX() const
+    {
+        assert(periodFound);
+        return displacementX;
+    }
+    const BigInteger & getDisplacementY() const
+    {
+        assert(periodFound);
+        return displacementY;
+    }
+    // the state generationCount generations after gs, which has to be in the cycle found (like any state observed since).
+    // moves the pattern by the displacement of the whole periods, then steps the remainder modulo the period.
+    // returns a null GameState if cancelled through control or if the pattern can't be moved (see GameState::translated)
+    GameState jump(GameState gs, const BigUnsigned & generationCount, StepControl *control = nullptr) const
+    {
+        assert(periodFound && gs);
+        BigUnsigned periodCount, remainder;
+        BigUnsigned::divide(generationCount, period, periodCount, remainder);
+        BigUnsigned generation = gs.generation + period * periodCount;
+        gs = gs.translated(displacementX * BigInteger(periodCount), displacementY * BigInteger(periodCount));
+        if(!gs)
+            return gs;
+        gs.generation = generation;
+        if(!gs.advance(remainder, control))
+            return GameState(nullptr);
+        return gs;
+    }
+};
+
+// steps many independent game states at once against their shared NodeGCHashTable.
+// a GameState is only ever used by one thread at a time, but any number of them can share a gc
+// as long as every thread building nodes in it is inside a MutatorScope; structure common to the states
+// (null nodes, still lifes, gliders) is then one set of nodes with one set of memoized next states
+class MultiverseRunner
+{
+    MultiverseRunner(const MultiverseRunner &) = delete;
+    const MultiverseRunner &operator =(const MultiverseRunner &) = delete;
+private:
+    ThreadPool threadPool;
+public:
+    explicit MultiverseRunner(size_t threadCount = ThreadPool::getDefaultThreadCount() + 1)
+        : threadPool(threadCount > 0 ? threadCount - 1 : 0) // the calling thread works too
+    {
+    }
+    size_t getThreadCount() const
+    {
+        return threadPool.size() + 1;
+    }
+    // calls fn(0) through fn(count - 1) on all the threads, each in a MutatorScope for gc
+    void parallelFor(NodeGCHashTable * gc, size_t count, function<void(size_t)> fn)
+    {
+        // the calling thread waits for the others without allocating, so it can't hold up gc
+        assert(NodeGCHashTable::mutatorScopeDepth == 0);
+        threadPool.parallelFor(count, [gc, &fn](size_t index)
+        {
+            MutatorScope mutatorScope(gc);
+            fn(index);
+        });
+    }
+    // advances every state by generationCount; the states must all use the same gc
+    void advance(vector<GameState> & states, const BigUnsigned & generationCount)
+    {
+        if(states.empty())
+            return;
+        NodeGCHashTable * gc = states.front().gc;
+        for(const GameState & gs : states)
+            assert(gs.gc == gc);
+        parallelFor(gc, states.size(), [&](size_t index)
+        {
+            states[index].advance(generationCount);
+        });
+    }
+};
+
+// apgsearch-style census of random soups : each soup is evolved until its population is periodic,
+// split into objects and each object named by its apgcode (period and canonical extended Wechsler format).
+// spaceships are counted and removed once they get far from the soup, so they don't keep growing the root.
+// the worker threads share one NodeGCHashTable, so common debris is built once
+// and its memoized next states are reused by every later soup
+class SoupCensus
+{
+    SoupCensus(const SoupCensus &) = delete;
+    const SoupCensus &operator =(const SoupCensus &) = delete;
+public:
+    static constexpr size_t soupSize = 16;
+    static constexpr size_t stabilizeLogStepSize = 4; // the population is sampled every 2^stabilizeLogStepSize generations
+    static constexpr size_t maxPopulationPeriod = 30; // in samples; soups whose population doesn't repeat within this are still evolving
+    static constexpr size_t minPopulationRepeatCount = 8; // in samples
+    static constexpr uint64_t maxGenerationCount = 1 << 15; // soups still evolving after this are counted as unstabilized
+    static constexpr size_t maxObjectPeriod = 64;
+    static constexpr size_t maxObjectSize = 40; // bigger objects are named by their period or population only
+    static constexpr int64_t escapeRadius = 8 * soupSize; // spaceships past this are counted and removed while the soup settles
+private:
+    static constexpr size_t maxObjectNameCacheSize = 1 << 14; // per thread
+    struct ObjectCell
+    {
+        int64_t x, y;
+        CellType cell;
+        bool operator <(const ObjectCell & rt) const // row by row
+        {
+            if(y != rt.y)
+                return y < rt.y;
+            if(x != rt.x)
+                return x < rt.x;
+            return cell < rt.cell;
+        }
+    };
+    typedef vector<ObjectCell> ObjectCells; // row by row
+    // names by getObjectKey : of the objects that each group of cells splits into, and of each object
+    struct ObjectNameCache
+    {
+        unordered_map<string, vector<string>> groupNames;
+        unordered_map<string, string> objectNames;
+    };
+    NodeGCHashTable * const gc;
+    const Rule * const rule;
+    const uint64_t seedHash;
+    std::mutex theLock;
+    map<string, uint64_t> objectCounts;
+    uint64_t soupCount = 0, unstabilizedSoupCount = 0;
+    static uint64_t splitMix64(uint64_t & state)
+    {
+        uint64_t retval = (state += 0x9E3779B97F4A7C15ULL);
+        retval = (retval ^ (retval >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        retval = (retval ^ (retval >> 27)) * 0x94D049BB133111EBULL;
+        return retval ^ (retval >> 31);
+    }
+    static uint64_t hashSeed(const string & seed) // FNV-1a, so that a seed gives the same soups everywhere
+    {
+        uint64_t retval = 0xCBF29CE484222325ULL;
+        for(unsigned char ch : seed)
+        {
+            retval ^= ch;
+            retval *= 0x100000001B3ULL;
+        }
+        return retval;
+    }
+    static bool isPopulationPeriodic(const vector<uint64_t> & populations)
+    {
+        size_t count = populations.size();
+        for(size_t period = 1; period <= maxPopulationPeriod; period++)
+        {
+            size_t checkCount = 2 * period;
+            if(checkCount < minPopulationRepeatCount)
+                checkCount = minPopulationRepeatCount;
+            if(count < checkCount + period)
+                return false;
+            bool periodic = true;
+            for(size_t i = count - checkCount; i < count && periodic; i++)
+                periodic = (populations[i] == populations[i - period]);
+            if(periodic)
+                return true;
+        }
+        return false;
+    }
+    static ObjectCells getCells(const GameState & gs)
+    {
+        ObjectCells retval;
+        for(LiveCellIterator iter(gs, LiveCellIterator::Order::RowMajor); iter.next();)
+            retval.push_back(ObjectCell{iter.getX(), iter.getY(), iter.getCell()});
+        return retval;
+    }
+    static bool isNear(const ObjectCell & a, const ObjectCell & b, int64_t distance)
+    {
+        return a.x - b.x <= distance && b.x - a.x <= distance && a.y - b.y <= distance && b.y - a.y <= distance;
+    }
+    static bool isNear(const ObjectCells & a, const ObjectCells & b, int64_t distance)
+    {
+        for(const ObjectCell & aCell : a)
+        {
+            for(const ObjectCell & bCell : b)
+            {
+                if(isNear(aCell, bCell, distance))
+                    return true;
+            }
+        }
+        return false;
+    }
+    static size_t findGroup(vector<size_t> & parents, size_t index)
+    {
+        while(parents[index] != index)
+            index = parents[index] = parents[parents[index]];
+        return index;
+    }
+    // splits cells into the groups of cells within distance of each other in both x and y, keeping them row by row.
+    // the cells are already row by row, so each cell's neighbors are found by scanning the cells after it up to distance rows down
+    static vector<ObjectCells> groupCells(const ObjectCells & cells, int64_t distance)
+    {
+        vector<size_t> parents(cells.size());
+        for(size_t i = 0; i < cells.size(); i++)
+            parents[i] = i;
+        for(size_t i = 0; i < cells.size(); i++)
+        {
+            for(size_t j = i + 1; j < cells.size() && cells[j].y - cells[i].y <= distance; j++)
+            {
+                if(isNear(cells[i], cells[j], distance))
+                    parents[findGroup(parents, j)] = findGroup(parents, i);
+            }
+        }
+        vector<size_t> groupIndexes(cells.size(), cells.size());
+        vector<ObjectCells> retval;
+        for(size_t i = 0; i < cells.size(); i++)
+        {
+            size_t & groupIndex = groupIndexes[findGroup(parents, i)];
+            if(groupIndex == cells.size())
+            {
+                groupIndex = retval.size();
+                retval.emplace_back();
+            }
+            retval[groupIndex].push_back(cells[i]);
+        }
+        return retval;
+    }
+    // the cells relative to their top left corner, so translated copies give the same key
+    static string getObjectKey(const ObjectCells & cells)
+    {
+        int64_t minX = cells.front().x, minY = cells.front().y;
+        for(const ObjectCell & cell : cells)
+            minX = min(minX, cell.x);
+        string retval;
+        for(const ObjectCell & cell : cells)
+        {
+            uint64_t values[3] = {(uint64_t)(cell.x - minX), (uint64_t)(cell.y - minY), cell.cell};
+            retval.append((const char *)values, sizeof(values));
+        }
+        return retval;
+    }
+    GameState makeObject(const ObjectCells & cells) const
+    {
+        GameState retval(gc, nullptr, 0, BigUnsigned(), rule);
+        for(const ObjectCell & cell : cells)
+            retval.setCell(cell.x, cell.y, cell.cell);
+        return retval;
+    }
+    // splits a group of cells into the parts that evolve on their own just like they do together, so that pseudo objects
+    // (like two blocks side by side) are counted as the objects they are made of. starts from the 8-connected parts
+    // and, whenever their separate evolutions add up to something different from the group's, merges the parts next to the difference.
+    // the parts are checked for one period of the group, or maxObjectPeriod generations if it doesn't repeat by then
+    vector<ObjectCells> splitObject(const ObjectCells & cells) const
+    {
+        vector<ObjectCells> parts = groupCells(cells, 1);
+        while(parts.size() > 1)
+        {
+            GameState whole = makeObject(cells);
+            vector<GameState> partStates;
+            for(const ObjectCells & part : parts)
+                partStates.push_back(makeObject(part));
+            vector<ObjectCells> lastPartCells = parts; // the generation before the differences
+            ObjectCells differences;
+            for(size_t generation = 0; generation < maxObjectPeriod && differences.empty(); generation++)
+            {
+                whole.step(0);
+                vector<ObjectCells> partCells;
+                ObjectCells combinedCells;
+                for(GameState & partState : partStates)
+                {
+                    partState.step(0);
+                    partCells.push_back(getCells(partState));
+                    combinedCells.insert(combinedCells.end(), partCells.back().begin(), partCells.back().end());
+                }
+                sort(combinedCells.begin(), combinedCells.end());
+                ObjectCells wholeCells = getCells(whole);
+                set_symmetric_difference(wholeCells.begin(), wholeCells.end(), combinedCells.begin(), combinedCells.end(), back_inserter(differences));
+                if(!differences.empty())
+                    break;
+                if(wholeCells.size() == cells.size() && equal(wholeCells.begin(), wholeCells.end(), cells.begin(), [](const ObjectCell & a, const ObjectCell & b)
+                {
+                    return a.x == b.x && a.y == b.y && a.cell == b.cell;
+                }))
+                    break;
+                lastPartCells = std::move(partCells);
+            }
+            vector<size_t> mergedParts;
+            if(differences.empty())
+            {
+                // a part that dies out without changing the others is a spark of a part next to it,
+                // like the cells that a spaceship loses in some of its phases
+                size_t dyingPart = 0;
+                while(dyingPart < parts.size() && !lastPartCells[dyingPart].empty())
+                    dyingPart++;
+                if(dyingPart == parts.size())
+                    break;
+                mergedParts.push_back(dyingPart);
+                for(size_t i = 0; i < parts.size() && mergedParts.size() < 2; i++)
+                {
+                    if(!lastPartCells[i].empty() && isNear(parts[i], parts[dyingPart], 2))
+                        mergedParts.push_back(i);
+                }
+            }
+            else
+            {
+                for(size_t i = 0; i < lastPartCells.size(); i++)
+                {
+                    if(isNear(lastPartCells[i], differences, 1))
+                        mergedParts.push_back(i);
+                }
+            }
+            if(mergedParts.size() < 2) // shouldn't happen, but always make progress
+                return vector<ObjectCells>{cells};
+            for(size_t i = 1; i < mergedParts.size(); i++)
+            {
+                ObjectCells & mergedPart = parts[mergedParts.front()];
+                mergedPart.insert(mergedPart.end(), parts[mergedParts[i]].begin(), parts[mergedParts[i]].end());
+                parts[mergedParts[i]].clear();
+            }
+            sort(parts[mergedParts.front()].begin(), parts[mergedParts.front()].end());
+            parts.erase(remove_if(parts.begin(), parts.end(), [](const ObjectCells & part)
+            {
+                return part.empty();
+            }), parts.end());
+        }
+        return parts;
+    }
+    // in extended Wechsler format : columns of 5 row strips as base 32 digits, strips separated by z and runs of zeros shortened
+    static string getWechslerCode(const vector<bool> & cells, size_t w, size_t h)
+    {
+        static const char digits[] = "0123456789abcdefghijklmnopqrstuvwxyz";
+        string retval;
+        for(size_t stripY = 0; stripY < h; stripY += 5)
+        {
+            if(stripY > 0)
+                retval += 'z';
+            string strip;
+            for(size_t x = 0; x < w; x++)
+            {
+                unsigned value = 0;
+                for(size_t y = stripY; y < stripY + 5 && y < h; y++)
+                {
+                    if(cells[x + y * w])
+                        value |= 1 << (y - stripY);
+                }
+                strip += digits[value];
+            }
+            strip.erase(strip.find_last_not_of('0') + 1);
+            for(size_t i = 0; i < strip.size();)
+            {
+                size_t zeroCount = 0;
+                while(i + zeroCount < strip.size() && strip[i + zeroCount] == '0')
+                    zeroCount++;
+                if(zeroCount == 0)
+                {
+                    retval += strip[i++];
+                    continue;
+                }
+                i += zeroCount;
+                for(; zeroCount >= 4; zeroCount -= min<size_t>(zeroCount, 39))
+                {
+                    retval += 'y';
+                    retval += digits[min<size_t>(zeroCount, 39) - 4];
+                }
+                if(zeroCount == 3)
+                    retval += 'x';
+                else if(zeroCount == 2)
+                    retval += 'w';
+                else if(zeroCount == 1)
+                    retval += '0';
+            }
+        }
+        return retval;
+    }
+    // the shortest code, then the first in alphabetical order, over the 8 orientations
+    static string getCanonicalWechslerCode(const GameState & gs)
+    {
+        CellBounds bounds;
+        if(!gs.getBounds(bounds) || bounds.empty)
+            return "0";
+        size_t w = (size_t)(bounds.maxX - bounds.minX + 1), h = (size_t)(bounds.maxY - bounds.minY + 1);
+        vector<CellType> cells(w * h);
+        gs.getRegion(bounds.minX, bounds.minY, w, h, cells.data(), w);
+        string retval;
+        for(int orientation = 0; orientation < 8; orientation++)
+        {
+            bool transpose = orientation & 1, flipX = orientation & 2, flipY = orientation & 4;
+            size_t orientedW = transpose ? h : w, orientedH = transpose ? w : h;
+            vector<bool> orientedCells(w * h);
+            for(size_t y = 0; y < orientedH; y++)
+            {
+                for(size_t x = 0; x < orientedW; x++)
+                {
+                    size_t sourceX = transpose ? y : x, sourceY = transpose ? x : y;
+                    if(flipX)
+                        sourceX = w - 1 - sourceX;
+                    if(flipY)
+                        sourceY = h - 1 - sourceY;
+                    orientedCells[x + y * orientedW] = (cells[sourceX + sourceY * w] != 0);
+                }
+            }
+            string code = getWechslerCode(orientedCells, orientedW, orientedH);
+            if(retval.empty() || code.size() < retval.size() || (code.size() == retval.size() && code < retval))
+                retval = code;
+        }
+        return retval;
+    }
+public:
+    static string getObjectName(GameState object)
+    {
+        PeriodDetector detector;
+        for(size_t generation = 0; !detector.observe(object); generation++)
+        {
+            if(generation > 2 * maxObjectPeriod)
+                return "PATHOLOGICAL";
+            object.step(0);
+        }
+        BigUnsigned period = detector.getPeriod();
+        bool moving = !detector.getDisplacementX().isZero() || !detector.getDisplacementY().isZero();
+        string prefix = moving ? "q" + period.toString() : (period == BigUnsigned(1) ? "s" + object.population().toString() : "p" + period.toString());
+        CellBounds bounds;
+        if(!object.getBounds(bounds) || (uint64_t)(bounds.maxX - bounds.minX) >= maxObjectSize || (uint64_t)(bounds.maxY - bounds.minY) >= maxObjectSize)
+            return "ov_" + prefix;
+        // the same object in every phase gives the same name
+        string code;
+        for(BigUnsigned phase = 0; phase < period; phase += BigUnsigned(1))
+        {
+            string phaseCode = getCanonicalWechslerCode(object);
+            if(code.empty() || phaseCode.size() < code.size() || (phaseCode.size() == code.size() && phaseCode < code))
+                code = phaseCode;
+            object.step(0);
+        }
+        return "x" + prefix + "_" + code;
+    }
+private:
+    // the names of the objects in a group of cells within 2 of each other; cells seen before in any position are a single lookup
+    const vector<string> & getObjectNames(const ObjectCells & cells, ObjectNameCache & cache) const
+    {
+        string key = getObjectKey(cells);
+        auto iter = cache.groupNames.find(key);
+        if(iter != cache.groupNames.end())
+            return iter->second;
+        vector<string> names;
+        for(const ObjectCells & object : splitObject(cells))
+        {
+            string objectKey = getObjectKey(object);
+            auto objectIter = cache.objectNames.find(objectKey);
+            if(objectIter == cache.objectNames.end())
+            {
+                if(cache.objectNames.size() >= maxObjectNameCacheSize)
+                    cache.objectNames.clear();
+                objectIter = cache.objectNames.insert(make_pair(objectKey, getObjectName(makeObject(object)))).first;
+            }
+            names.push_back(objectIter->second);
+        }
+        if(cache.groupNames.size() >= maxObjectNameCacheSize)
+            cache.groupNames.clear();
+        return cache.groupNames[key] = std::move(names);
+    }
+    // counts and removes the groups of cells entirely past escapeRadius that are made of spaceships,
+    // which would otherwise keep growing the root; returns true if it removed any
+    bool removeEscapedObjects(GameState & gs, ObjectNameCache & cache, vector<string> & objectNames) const
+    {
+        bool removedAny = false;
+        for(const ObjectCells & cells : groupCells(getCells(gs), 2))
+        {
+            bool escaped = true;
+            for(const ObjectCell & cell : cells)
+            {
+                if(cell.x >= -escapeRadius && cell.x <= escapeRadius && cell.y >= -escapeRadius && cell.y <= escapeRadius)
+                    escaped = false;
+            }
+            if(!escaped)
+                continue;
+            const vector<string> & names = getObjectNames(cells, cache);
+            bool allSpaceships = true;
+            for(const string & name : names)
+            {
+                if(name.compare(0, 2, "xq") != 0)
+                    allSpaceships = false;
+            }
+            if(!allSpaceships)
+                continue;
+            objectNames.insert(objectNames.end(), names.begin(), names.end());
+            for(const ObjectCell & cell : cells)
+                gs.setCell(cell.x, cell.y, 0);
+            removedAny = true;
+        }
+        return removedAny;
+    }
+public:
+    SoupCensus(NodeGCHashTable * gc, const string & seed, const Rule * rule = Rule::getLife())
+        : gc(gc), rule(rule), seedHash(hashSeed(seed))
+    {
+    }
+    // a soupSize by soupSize square of random cells around the origin, built straight into the tree
+    GameState makeSoup(uint64_t soupIndex) const
+    {
+        uint64_t state = seedHash ^ (soupIndex * 0xD1B54A32D192ED03ULL);
+        uint8_t bits[soupSize * soupSize / 8];
+        for(size_t i = 0; i < sizeof(bits); i += sizeof(uint64_t))
+        {
+            uint64_t value = splitMix64(state);
+            for(size_t j = 0; j < sizeof(uint64_t); j++)
+                bits[i + j] = (uint8_t)(value >> (8 * j));
+        }
+        GameState retval(gc, nullptr, 0, BigUnsigned(), rule);
+        retval.setRegionBitmap(-(int64_t)soupSize / 2, -(int64_t)soupSize / 2, soupSize, soupSize, bits, soupSize / 8);
+        return retval;
+    }
+private:
+    // runs until the population is periodic; returns false if that doesn't happen within maxGenerationCount generations.
+    // big steps are much cheaper per generation than single generations, and a periodic population stays periodic when sampled.
+    // spaceships leaving the soup are added to objectNames and removed, see removeEscapedObjects
+    bool stabilize(GameState & gs, ObjectNameCache & cache, vector<string> & objectNames) const
+    {
+        vector<uint64_t> populations;
+        for(uint64_t generation = 0; generation < maxGenerationCount; generation += (uint64_t)1 << stabilizeLogStepSize)
+        {
+            CellBounds bounds;
+            if(gs.getBounds(bounds) && !bounds.empty
+                    && (bounds.minX < -escapeRadius || bounds.minY < -escapeRadius || bounds.maxX > escapeRadius || bounds.maxY > escapeRadius)
+                    && removeEscapedObjects(gs, cache, objectNames))
+                populations.clear(); // the population dropped, so the period has to be found again
+            populations.push_back(gs.rootNode->getPopulation());
+            if(isPopulationPeriodic(populations))
+                return true;
+            gs.step(stabilizeLogStepSize);
+        }
+        return false;
+    }
+public:
+    // runs soupCount more soups on all of runner's threads and adds the objects they settle into to the census
+    void run(uint64_t soupCount, MultiverseRunner & runner)
+    {
+        uint64_t startSoupIndex;
+        {
+            lock_guard<std::mutex> lock(theLock);
+            startSoupIndex = this->soupCount;
+        }
+        atomic_uint_fast64_t nextSoupIndex(startSoupIndex);
+        uint64_t endSoupIndex = startSoupIndex + soupCount;
+        // one task per thread, each keeping its own name cache and counts until the end
+        runner.parallelFor(gc, runner.getThreadCount(), [&](size_t)
+        {
+            ObjectNameCache cache;
+            map<string, uint64_t> threadObjectCounts;
+            uint64_t threadUnstabilizedSoupCount = 0;
+            vector<string> objectNames;
+            for(uint64_t soupIndex = nextSoupIndex++; soupIndex < endSoupIndex; soupIndex = nextSoupIndex++)
+            {
+                GameState gs = makeSoup(soupIndex);
+                objectNames.clear();
+                if(!stabilize(gs, cache, objectNames))
+                {
+                    threadUnstabilizedSoupCount++;
+                    continue;
+                }
+                // cells within 2 of each other can affect each other, so each group is split by getObjectNames
+                for(const ObjectCells & cells : groupCells(getCells(gs), 2))
+                {
+                    const vector<string> & names = getObjectNames(cells, cache);
+                    objectNames.insert(objectNames.end(), names.begin(), names.end());
+                }
+                for(const string & name : objectNames)
+                    threadObjectCounts[name]++;
+            }
+            lock_guard<std::mutex> lock(theLock);
+            for(auto & objectCount : threadObjectCounts)
+                objectCounts[objectCount.first] += objectCount.second;
+            unstabilizedSoupCount += threadUnstabilizedSoupCount;
+        });
+        lock_guard<std::mutex> lock(theLock);
+        this->soupCount = endSoupIndex;
+    }
+    // the object counts, most common first
+    void writeReport(ostream & os)
+    {
+        lock_guard<std::mutex> lock(theLock);
+        vector<pair<string, uint64_t>> sortedCounts(objectCounts.begin(), objectCounts.end());
+        stable_sort(sortedCounts.begin(), sortedCounts.end(), [](const pair<string, uint64_t> & a, const pair<string, uint64_t> & b)
+        {
+            return a.second > b.second;
+        });
+        os << "Soups : " << soupCount << "     Unstabilized : " << unstabilizedSoupCount << "\n";
+        for(auto & objectCount : sortedCounts)
+            os << objectCount.first << " " << objectCount.second << "\n";
+    }
+};
+
+// picks the step size for hyperspeed mode from the measured time and memo hit rate of each step :
+// a step is expected to cost about (1 + miss rate) times as much at twice the size,
+// so the step size grows while that still fits the target time and shrinks when a step takes too long
+class StepSizeTuner
+{
+    StepSizeTuner(const StepSizeTuner &) = delete;
+    const StepSizeTuner &operator =(const StepSizeTuner &) = delete;
+private:
+    const double targetStepSeconds;
+    atomic_size_t logStepSize;
+public:
+    explicit StepSizeTuner(double targetStepSeconds, size_t logStepSize = 0)
+        : targetStepSeconds(targetStepSeconds), logStepSize(logStepSize)
+    {
+    }
+    size_t getLogStepSize() const
+    {
+        return logStepSize;
+    }
+    void setLogStepSize(size_t logStepSize)
+    {
+        this->logStepSize = logStepSize;
+    }
+    void stepDone(size_t logStepSize, double seconds, uint64_t memoHitCount, uint64_t memoMissCount)
+    {
+        double missRate = 1;
+        if(memoHitCount + memoMissCount > 0)
+            missRate = (double)memoMissCount / (memoHitCount + memoMissCount);
+        if(seconds > 2 * targetStepSeconds)
+        {
+            if(logStepSize > 0)
+                this->logStepSize = logStepSize - 1;
+        }
+        else if(seconds * (1 + missRate) <= targetStepSeconds)
+            this->logStepSize = logStepSize + 1;
+        else
+            this->logStepSize = logStepSize;
+    }
+    // returns false and leaves the state unchanged if cancelled through control
+    bool step(GameState & gs, StepControl *control = nullptr)
+    {
+        size_t logStepSize = this->logStepSize;
+        uint64_t startHitCount = NodeGCHashTable::threadMemoHitCount, startMissCount = NodeGCHashTable::threadMemoMissCount;
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        if(!gs.step(logStepSize, control))
+            return false;
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        stepDone(logStepSize, seconds, NodeGCHashTable::threadMemoHitCount - startHitCount, NodeGCHashTable::threadMemoMissCount - startMissCount);
+        return true;
+    }
+};
+
+// past states for going back without recomputing. nodes are shared, so a kept state only costs the nodes it doesn't have
+// in common with the others. the recentCapacity latest recorded states and, as checkpoints, the first state recorded
+// at or past each power of two generation are kept; states that fall out of the recent ones are only weakly referenced
+// (up to olderCapacity of them), so they stay until gc needs their nodes. once the node table is past
+// pressureNodeCount, recording also demotes every recent state but the latest, so only it and the checkpoints are kept
+// from gc when it runs.
+// not thread safe; use it inside a MutatorScope when other threads use the same node table
+class GameHistory
+{
+    GameHistory(const GameHistory &) = delete;
+    const GameHistory &operator =(const GameHistory &) = delete;
+private:
+    struct WeakSnapshot
+    {
+        BigUnsigned generation;
+        NodeWeakReference rootNode;
+        CellType backgroundType;
+        const Rule * rule;
+    };
+    static constexpr size_t pressureNodeCount = startGCNodeCount / 2;
+    NodeGCHashTable * gc = nullptr;
+    const size_t recentCapacity, olderCapacity;
+    deque<GameState> recent; // each sorted by generation
+    deque<WeakSnapshot> older;
+    vector<GameState> checkpoints; // indexed by the bit length of the generation; GameState(nullptr) if there is none
+    void demoteOldestRecent()
+    {
+        if(olderCapacity > 0)
+        {
+            const GameState & oldest = recent.front();
+            older.push_back(WeakSnapshot{oldest.generation, NodeWeakReference(oldest.rootNode), oldest.backgroundType, oldest.rule});
+            if(older.size() > olderCapacity)
+                older.pop_front();
+        }
+        recent.pop_front();
+    }
+public:
+    explicit GameHistory(size_t recentCapacity = 64, size_t olderCapacity = 1024)
+        : recentCapacity(recentCapacity), olderCapacity(olderCapacity)
+    {
+        assert(recentCapacity > 0);
+    }
+    void clear()
+    {
+        recent.clear();
+        older.clear();
+        checkpoints.clear();
+    }
+    // drops the states at or after generation
+    void truncate(const BigUnsigned & generation)
+    {
+        while(!recent.empty() && recent.back().generation >= generation)
+            recent.pop_back();
+        while(!older.empty() && older.back().generation >= generation)
+            older.pop_back();
+        while(!checkpoints.empty() && (!checkpoints.back() || checkpoints.back().generation >= generation))
+            checkpoints.pop_back();
+    }
+    // drops the states at or after gs's generation first, so recording after going back starts a new timeline
+    void record(const GameState & gs)
+    {
+        assert(gs);
+        if(gc != gs.gc)
+        {
+            clear();
+            gc = gs.gc;
+        }
+        truncate(gs.generation);
+        size_t checkpointIndex = gs.generation.bitLength();
+        if(checkpoints.size() <= checkpointIndex)
+            checkpoints.resize(checkpointIndex + 1, GameState(nullptr));
+        if(!checkpoints[checkpointIndex])
+            checkpoints[checkpointIndex] = gs;
+        recent.push_back(gs);
+        size_t keptCount = (gc->nodeCount > pressureNodeCount ? 1 : recentCapacity);
+        while(recent.size() > keptCount)
+        {
+            demoteOldestRecent();
+        }
+    }
+    // the latest kept state at or before generation, or GameState(nullptr) if there is none
+    GameState getLatest(const BigUnsigned & generation) const
+    {
+        GameState retval(nullptr);
+        auto isAfter = [](const BigUnsigned & generation, const GameState & gs)
+        {
+            return generation < gs.generation;
+        };
+        auto recentIterator = upper_bound(recent.begin(), recent.end(), generation, isAfter);
+        if(recentIterator != recent.begin())
+            retval = *(recentIterator - 1);
+        for(const GameState & checkpoint : checkpoints)
+        {
+            if(checkpoint && checkpoint.generation <= generation && (!retval || checkpoint.generation > retval.generation))
+                retval = checkpoint;
+        }
+        auto isAfterSnapshot = [](const BigUnsigned & generation, const WeakSnapshot & snapshot)
+        {
+            return generation < snapshot.generation;
+        };
+        for(auto olderIterator = upper_bound(older.begin(), older.end(), generation, isAfterSnapshot); olderIterator != older.begin();)
+        {
+            --olderIterator;
+            if(retval && olderIterator->generation <= retval.generation)
+                break;
+            NodeReference rootNode = olderIterator->rootNode.get();
+            if(rootNode != nullptr) // not freed by gc
+            {
+                retval = GameState(gc, rootNode, olderIterator->backgroundType, olderIterator->generation, olderIterator->rule);
+                break;
+            }
+        }
+        return retval;
+    }
+    // the kept state at generation, or GameState(nullptr) if it wasn't kept
+    GameState get(const BigUnsigned & generation) const
+    {
+        GameState retval = getLatest(generation);
+        if(retval && retval.generation != generation)
+            return GameState(nullptr);
+        return retval;
+    }
+    // the latest kept state before generation, for stepping back
+    GameState getPrevious(const BigUnsigned & generation) const
+    {
+        if(generation.isZero())
+            return GameState(nullptr);
+        return getLatest(generation - BigUnsigned(1));
+    }
+    // the state at generation, by advancing the latest kept state before it the rest of the way, without recording anything;
+    // returns GameState(nullptr) if there is no kept state at or before generation or if cancelled through control
+    GameState seek(const BigUnsigned & generation, StepControl *control = nullptr) const
+    {
+        GameState retval = getLatest(generation);
+        if(retval && !retval.advance(generation - retval.generation, control))
+            return GameState(nullptr);
+        return retval;
+    }
+};
+
+// reads an .rle file, placed at the #CXRLE Pos= position when there is one; reports progress and failures on progress
+GameState readRLE(istream & is, NodeGCHashTable * gc, ostream & progress = cout);
+
+string getRLECellCode(CellType cellType);
+
+// the inclusive bounds of the cells that aren't background;
+// returns false if the pattern is too far from the origin for 64-bit coordinates
+bool getPatternBounds(const GameState & gs, CellBounds & bounds);
+
+// returns false if the pattern is too far from the origin for 64-bit coordinates
+bool writeRLE(ostream & os, const GameState & gs);
+
+// macrocell (.mc) files store the quadtree itself : a "[M2]" line, optional "#R rule" and "#G generation" lines,
+// then one node per line, each only referencing lines before it, with the last line as the root (centered on the origin).
+// a line is either an 8 by 8 block drawn with '.' (dead), '*' (live) and '$' (end of row)
+// or "size-log nxny pxny nxpy pxpy" where the children are line numbers (starting at 1) and 0 is an empty node,
+// except when size-log is 1, where they are cell states
+GameState readMacrocell(istream & is, NodeGCHashTable * gc, ostream & progress = cout);
+
+// writes gs in the macrocell format, which stays small for huge or very regular patterns; the background has to be 0.
+// patterns with only 0 and 1 cells are written with 8 by 8 blocks, like two-state programs expect
+bool writeMacrocell(ostream & os, const GameState & gs);
+
+// reads a macrocell file or an .rle file, going by the first character
+GameState readPattern(istream & is, NodeGCHashTable * gc, ostream & progress = cout);
+
+// writes a macrocell file for file names ending in .mc and an .rle file otherwise
+bool writePattern(ostream & os, const GameState & gs, const string & fileName);
+
+// writes the pixels (rows pitch bytes apart) as an 8-bit RGB PNG image. the image data is stored without compression,
+// so encoding is about as fast as copying and doesn't need zlib
+bool writePNG(ostream & os, const Color * pixels, int w, int h, int pitch);
+
+// writes the pixels as w * h * 3 bytes of RGB, which video encoders read as raw rgb24 frames
+bool writeRawRGB(ostream & os, const Color * pixels, int w, int h, int pitch);
+
+bool writeCheckpoint(string fileName, const GameState & gs);
+
+GameState readCheckpoint(string fileName, NodeGCHashTable * gc);
+
+#endif // HASHLIFE_H_INCLUDED
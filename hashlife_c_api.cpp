@@ -0,0 +1,261 @@
+#include "hashlife_c_api.h"
+#include "hashlife.h"
+#include <cstdlib>
+
+using namespace std;
+
+static_assert(sizeof(CellType) == sizeof(uint32_t), "cells are passed as uint32_t");
+
+struct hashlife_universe
+{
+    NodeGCHashTable gc;
+    atomic_size_t stateCount;
+    hashlife_universe()
+        : stateCount(0)
+    {
+    }
+};
+
+struct hashlife_state
+{
+    hashlife_universe * universe;
+    GameState gs;
+    hashlife_state(hashlife_universe * universe, GameState gs)
+        : universe(universe), gs(gs)
+    {
+        universe->stateCount++;
+    }
+    ~hashlife_state()
+    {
+        universe->stateCount--;
+    }
+};
+
+namespace
+{
+// keeps the library quiet : the readers report progress for the command line
+struct DiscardStream : public ostream
+{
+    DiscardStream()
+        : ostream(nullptr)
+    {
+    }
+};
+
+hashlife_state * makeState(hashlife_universe * universe, const GameState & gs)
+{
+    if(!gs)
+        return nullptr;
+    return new hashlife_state(universe, gs);
+}
+
+int getUInt64(const BigUnsigned & value, uint64_t * result)
+{
+    if(!value.fitsInUInt64())
+        return HASHLIFE_TOO_BIG;
+    *result = value.toUInt64();
+    return HASHLIFE_OK;
+}
+}
+
+extern "C"
+{
+int hashlife_get_api_version(void)
+{
+    return HASHLIFE_C_API_VERSION;
+}
+
+uint64_t hashlife_get_max_node_count(void)
+{
+    return maxNodeCount;
+}
+
+hashlife_universe * hashlife_universe_create(void)
+{
+    return new hashlife_universe;
+}
+
+int hashlife_universe_destroy(hashlife_universe * universe)
+{
+    if(universe == nullptr)
+        return HASHLIFE_OK;
+    if(universe->stateCount != 0)
+        return HASHLIFE_ERROR;
+    delete universe;
+    return HASHLIFE_OK;
+}
+
+void hashlife_universe_get_stats(const hashlife_universe * universe, hashlife_stats * stats)
+{
+    stats->node_count = universe->gc.nodeCount;
+    stats->memo_hit_count = universe->gc.memoHitCount;
+    stats->memo_miss_count = universe->gc.memoMissCount;
+}
+
+hashlife_state * hashlife_state_create(hashlife_universe * universe, const char * rule)
+{
+    const Rule * parsedRule = (rule == nullptr ? Rule::getLife() : Rule::parse(rule));
+    if(parsedRule == nullptr)
+        return nullptr;
+    MutatorScope mutatorScope(&universe->gc);
+    return makeState(universe, GameState(&universe->gc, nullptr, 0, BigUnsigned(), parsedRule));
+}
+
+hashlife_state * hashlife_state_load(hashlife_universe * universe, const char * file_name)
+{
+    ifstream is(file_name);
+    if(!is)
+        return nullptr;
+    DiscardStream progress;
+    MutatorScope mutatorScope(&universe->gc);
+    return makeState(universe, readPattern(is, &universe->gc, progress));
+}
+
+hashlife_state * hashlife_state_parse(hashlife_universe * universe, const char * text, size_t length)
+{
+    istringstream is(string(text, length));
+    DiscardStream progress;
+    MutatorScope mutatorScope(&universe->gc);
+    return makeState(universe, readPattern(is, &universe->gc, progress));
+}
+
+hashlife_state * hashlife_state_copy(const hashlife_state * state)
+{
+    MutatorScope mutatorScope(&state->universe->gc);
+    return makeState(state->universe, state->gs);
+}
+
+void hashlife_state_destroy(hashlife_state * state)
+{
+    if(state == nullptr)
+        return;
+    MutatorScope mutatorScope(&state->universe->gc);
+    delete state;
+}
+
+int hashlife_state_advance(hashlife_state * state, uint64_t generation_count)
+{
+    MutatorScope mutatorScope(&state->universe->gc);
+    state->gs.advance(BigUnsigned(generation_count));
+    return HASHLIFE_OK;
+}
+
+int hashlife_state_advance_decimal(hashlife_state * state, const char * generation_count)
+{
+    BigUnsigned generationCount;
+    if(!BigUnsigned::parse(generation_count, generationCount))
+        return HASHLIFE_ERROR;
+    MutatorScope mutatorScope(&state->universe->gc);
+    state->gs.advance(generationCount);
+    return HASHLIFE_OK;
+}
+
+int hashlife_state_get_generation(const hashlife_state * state, uint64_t * generation)
+{
+    return getUInt64(state->gs.generation, generation);
+}
+
+int hashlife_state_get_population(const hashlife_state * state, uint64_t * population)
+{
+    MutatorScope mutatorScope(&state->universe->gc);
+    return getUInt64(state->gs.population(), population);
+}
+
+int hashlife_state_get_bounds(const hashlife_state * state, int64_t * min_x, int64_t * min_y, int64_t * max_x, int64_t * max_y)
+{
+    MutatorScope mutatorScope(&state->universe->gc);
+    CellBounds bounds;
+    if(!getPatternBounds(state->gs, bounds))
+        return HASHLIFE_TOO_BIG;
+    if(bounds.empty)
+        return HASHLIFE_EMPTY;
+    *min_x = bounds.minX;
+    *min_y = bounds.minY;
+    *max_x = bounds.maxX;
+    *max_y = bounds.maxY;
+    return HASHLIFE_OK;
+}
+
+uint32_t hashlife_state_get_cell(const hashlife_state * state, int64_t x, int64_t y)
+{
+    MutatorScope mutatorScope(&state->universe->gc);
+    return state->gs.getCell(x, y);
+}
+
+void hashlife_state_set_cell(hashlife_state * state, int64_t x, int64_t y, uint32_t cell)
+{
+    MutatorScope mutatorScope(&state->universe->gc);
+    state->gs.setCell(x, y, cell);
+}
+
+int hashlife_state_get_region(const hashlife_state * state, int64_t x, int64_t y, uint64_t width, uint64_t height, uint32_t * cells, size_t stride)
+{
+    if(width == 0 || height == 0)
+        return HASHLIFE_OK;
+    if(width - 1 > ~((uint64_t)x + coordinateBias) || height - 1 > ~((uint64_t)y + coordinateBias) || stride < width)
+        return HASHLIFE_ERROR; // goes past INT64_MAX
+    MutatorScope mutatorScope(&state->universe->gc);
+    state->gs.getRegion(x, y, width, height, cells, stride);
+    return HASHLIFE_OK;
+}
+
+int hashlife_state_diff_squares(const hashlife_state * old_state, const hashlife_state * new_state, unsigned log_size, hashlife_changed_square_callback callback, void * user_data)
+{
+    if(old_state->universe != new_state->universe || old_state->gs.backgroundType != new_state->gs.backgroundType)
+        return HASHLIFE_ERROR;
+    vector<ChangedSquare> changedSquares;
+    {
+        MutatorScope mutatorScope(&old_state->universe->gc);
+        if(!diffStates(old_state->gs, new_state->gs, log_size, changedSquares))
+            return HASHLIFE_TOO_BIG;
+    }
+    for(const ChangedSquare & changedSquare : changedSquares)
+        callback(user_data, changedSquare.x, changedSquare.y, changedSquare.size);
+    return HASHLIFE_OK;
+}
+
+int hashlife_state_diff_cells(const hashlife_state * old_state, const hashlife_state * new_state, hashlife_changed_cell_callback callback, void * user_data)
+{
+    if(old_state->universe != new_state->universe || old_state->gs.backgroundType != new_state->gs.backgroundType)
+        return HASHLIFE_ERROR;
+    vector<ChangedCell> changedCells;
+    {
+        MutatorScope mutatorScope(&old_state->universe->gc);
+        if(!diffStates(old_state->gs, new_state->gs, changedCells))
+            return HASHLIFE_TOO_BIG;
+    }
+    for(const ChangedCell & changedCell : changedCells)
+        callback(user_data, changedCell.x, changedCell.y, (uint32_t)changedCell.oldCell, (uint32_t)changedCell.newCell);
+    return HASHLIFE_OK;
+}
+
+int hashlife_state_save(const hashlife_state * state, const char * file_name)
+{
+    ofstream os(file_name);
+    MutatorScope mutatorScope(&state->universe->gc);
+    bool written = writePattern(os, state->gs, file_name);
+    os.close();
+    return written && os ? HASHLIFE_OK : HASHLIFE_ERROR;
+}
+
+char * hashlife_state_export(const hashlife_state * state, hashlife_format format)
+{
+    ostringstream os;
+    {
+        MutatorScope mutatorScope(&state->universe->gc);
+        bool written = (format == HASHLIFE_FORMAT_MACROCELL ? writeMacrocell(os, state->gs) : writeRLE(os, state->gs));
+        if(!written)
+            return nullptr;
+    }
+    string text = os.str();
+    char * retval = (char *)malloc(text.size() + 1);
+    if(retval != nullptr)
+        memcpy(retval, text.c_str(), text.size() + 1);
+    return retval;
+}
+
+void hashlife_free(void * pointer)
+{
+    free(pointer);
+}
+}
@@ -0,0 +1,101 @@
+#ifndef HASHLIFE_C_API_H_INCLUDED
+#define HASHLIFE_C_API_H_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* C interface to the hashlife engine, for embedding it in other programs.
+ * a universe is one node table with its memoized results; all the states in a universe share it,
+ * so structure and work they have in common is only stored and computed once.
+ * different states can be used from different threads at the same time, even in the same universe,
+ * but one state can't be used by two threads at the same time.
+ * a universe holds at most hashlife_get_max_node_count() nodes, counting the ones gc can't free because states use them
+ * (directly, or through the results memoized for them). going over that limit prints "out of memory" and ends the
+ * whole process, since a step that runs out can't be unwound; keep node_count in hashlife_stats well below it, by
+ * destroying states that aren't needed, when stepping patterns that keep growing. */
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define HASHLIFE_C_API_VERSION 3
+
+typedef struct hashlife_universe hashlife_universe;
+typedef struct hashlife_state hashlife_state;
+
+enum
+{
+    HASHLIFE_OK = 0,
+    HASHLIFE_EMPTY = 1, /* hashlife_state_get_bounds : every cell is background */
+    HASHLIFE_ERROR = -1,
+    HASHLIFE_TOO_BIG = -2 /* the result doesn't fit in 64 bits */
+};
+
+typedef enum hashlife_format
+{
+    HASHLIFE_FORMAT_RLE = 0,
+    HASHLIFE_FORMAT_MACROCELL = 1
+} hashlife_format;
+
+typedef struct hashlife_stats
+{
+    uint64_t node_count;
+    uint64_t memo_hit_count;
+    uint64_t memo_miss_count;
+} hashlife_stats;
+
+/* HASHLIFE_C_API_VERSION of the library */
+int hashlife_get_api_version(void);
+/* the most nodes a universe can hold; see above */
+uint64_t hashlife_get_max_node_count(void);
+
+hashlife_universe * hashlife_universe_create(void);
+/* every state in the universe has to be destroyed first : returns HASHLIFE_ERROR without destroying anything if
+ * any are left */
+int hashlife_universe_destroy(hashlife_universe * universe);
+void hashlife_universe_get_stats(const hashlife_universe * universe, hashlife_stats * stats);
+
+/* an empty state at generation 0; rule is like "B3/S23", NULL for Life. returns NULL if the rule isn't valid */
+hashlife_state * hashlife_state_create(hashlife_universe * universe, const char * rule);
+/* reads an .rle or macrocell file; returns NULL if it can't be read */
+hashlife_state * hashlife_state_load(hashlife_universe * universe, const char * file_name);
+/* reads .rle or macrocell text from memory; returns NULL if it isn't valid */
+hashlife_state * hashlife_state_parse(hashlife_universe * universe, const char * text, size_t length);
+/* the copy shares all its nodes with state, so it's cheap */
+hashlife_state * hashlife_state_copy(const hashlife_state * state);
+void hashlife_state_destroy(hashlife_state * state);
+
+int hashlife_state_advance(hashlife_state * state, uint64_t generation_count);
+/* for generation counts with more than 64 bits, in decimal */
+int hashlife_state_advance_decimal(hashlife_state * state, const char * generation_count);
+int hashlife_state_get_generation(const hashlife_state * state, uint64_t * generation);
+int hashlife_state_get_population(const hashlife_state * state, uint64_t * population);
+/* the inclusive bounds of the cells that aren't background */
+int hashlife_state_get_bounds(const hashlife_state * state, int64_t * min_x, int64_t * min_y, int64_t * max_x, int64_t * max_y);
+uint32_t hashlife_state_get_cell(const hashlife_state * state, int64_t x, int64_t y);
+void hashlife_state_set_cell(hashlife_state * state, int64_t x, int64_t y, uint32_t cell);
+/* copies the width by height cells at (x, y) to cells, with rows stride cells apart */
+int hashlife_state_get_region(const hashlife_state * state, int64_t x, int64_t y, uint64_t width, uint64_t height, uint32_t * cells, size_t stride);
+
+typedef void (*hashlife_changed_square_callback)(void * user_data, int64_t x, int64_t y, uint64_t size);
+typedef void (*hashlife_changed_cell_callback)(void * user_data, int64_t x, int64_t y, uint32_t old_cell, uint32_t new_cell);
+/* what changed from old_state to new_state, found without looking at the parts they share, for redrawing or
+ * sending only what changed. calls callback for each size by size square (size = 2 to the log_size, aligned to size)
+ * with cells that differ. both states have to be in the same universe and have the same background cell.
+ * returns HASHLIFE_TOO_BIG if the states are too big for 64-bit coordinates, or if log_size is over 62 */
+int hashlife_state_diff_squares(const hashlife_state * old_state, const hashlife_state * new_state, unsigned log_size, hashlife_changed_square_callback callback, void * user_data);
+/* calls callback for each cell that differs */
+int hashlife_state_diff_cells(const hashlife_state * old_state, const hashlife_state * new_state, hashlife_changed_cell_callback callback, void * user_data);
+
+/* writes a macrocell file for file names ending in .mc and an .rle file otherwise */
+int hashlife_state_save(const hashlife_state * state, const char * file_name);
+/* the pattern as text; free it with hashlife_free. returns NULL if the pattern can't be written in format */
+char * hashlife_state_export(const hashlife_state * state, hashlife_format format);
+void hashlife_free(void * pointer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* HASHLIFE_C_API_H_INCLUDED */
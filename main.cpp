@@ -8,1817 +8,1101 @@
 #else
 #include <SDL2/SDL.h>
 #endif // USE_SDL_1_x
-#include <atomic>
-#include <cstdint>
-#include <mutex>
-#include <cassert>
-#include <thread>
-#include <iostream>
-#include <initializer_list>
-#include <vector>
-#include <unordered_map>
-#include <unordered_set>
-#include <sstream>
-#include <algorithm>
-#include <array>
-#include <fstream>
-#include "bigfloat.h"
+#include <future>
+#if (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#define USE_UNIX_SOCKETS
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <csignal>
+#include <cerrno>
+#endif // (defined(__unix__) || defined(__APPLE__)) && !defined(__EMSCRIPTEN__)
+#include "hashlife.h"
 
 using namespace std;
 
-#ifdef __EMSCRIPTEN__
-constexpr size_t maxNodeCount = 600000;
-#else
-constexpr size_t maxNodeCount = 3000000;
-#endif
-constexpr size_t startGCNodeCount = 6 * maxNodeCount / 7;
-
-typedef uint_least32_t CellType;
-
-typedef uint32_t Color;
-
-constexpr Color RGBA(int R, int G, int B, int A)
-{
-    return (((Color)A & 0xFF) << 24) | (((Color)R & 0xFF) << 16) | (((Color)G & 0xFF) << 8) | ((
-                Color)B & 0xFF);
-}
-
-constexpr Color RGB(int R, int G, int B)
-{
-    return RGBA(R, G, B, 0xFF);
-}
-
-constexpr int getR(Color c)
-{
-    return (int)((c >> 16) & 0xFF);
-}
-
-constexpr int getG(Color c)
-{
-    return (int)((c >> 8) & 0xFF);
-}
-
-constexpr int getB(Color c)
-{
-    return (int)(c & 0xFF);
-}
-
-constexpr int getA(Color c)
-{
-    return (int)((c >> 24) & 0xFF);
-}
-
-typedef Color CellColorDescriptor;
-
-CellColorDescriptor getCellColorDescriptor(CellType cellType)
-{
-    switch(cellType % 8)
-    {
-    case 0:
-        if(cellType != 0)
-            return RGB(0x80, 0x80, 0x80);
-        return RGB(0, 0, 0);
-    case 7:
-        return RGB(0, 0, 0xFF);
-    case 2:
-        return RGB(0, 0xFF, 0);
-    case 3:
-        return RGB(0, 0xFF, 0xFF);
-    case 4:
-        return RGB(0xFF, 0, 0);
-    case 5:
-        return RGB(0xFF, 0, 0xFF);
-    case 6:
-        return RGB(0xFF, 0xFF, 0);
-    default:
-        return RGB(0xFF, 0xFF, 0xFF);
-    }
-}
-
-CellColorDescriptor combineCellColorDescriptors(initializer_list<CellColorDescriptor> descriptors)
-{
-    int R = 0, G = 0, B = 0;
-    size_t count = 0;
-    for(CellColorDescriptor descriptor : descriptors)
-    {
-        if((descriptor & RGBA(0xFF, 0xFF, 0xFF, 0)) != 0)
-        {
-            R += getR(descriptor);
-            G += getG(descriptor);
-            B += getB(descriptor);
-            count++;
-        }
-    }
-
-    if(count > 0)
-    {
-        R += count / 2;
-        G += count / 2;
-        B += count / 2;
-        R /= count;
-        G /= count;
-        B /= count;
-    }
-    return RGB(R, G, B);
-}
-
-Color getCellColorDescriptorColor(CellColorDescriptor descriptor)
-{
-    return descriptor;
-}
-
-static array<array<CellType, 9>, 2> rules;
-
-void clearRules()
-{
-    for(auto & row : rules)
-    {
-        for(auto & v : row)
-        {
-            v = 0;
-        }
-    }
-}
-
-void setLifeRules()
-{
-    clearRules();
-    rules[0][3] = 1;
-    rules[1][2] = 1;
-    rules[1][3] = 1;
-}
-
-bool parseRules(string rulesString)
-{
-    bool gotB = false, gotSlash = false, gotS = false;
-    clearRules();
-    for(char ch : rulesString)
-    {
-        if(ch == 'B')
-        {
-            if(gotB)
-                return false;
-            gotB = true;
-        }
-        else if(ch == '/')
-        {
-            if(!gotB || gotSlash)
-                return false;
-            gotSlash = true;
-        }
-        else if(ch == 'S')
-        {
-            if(!gotB || !gotSlash || gotS)
-                return false;
-            gotS = true;
-        }
-        else if(ch >= '0' && ch <= '8')
-        {
-            if(!gotB)
-                return false;
-            if(gotSlash)
-            {
-                if(!gotS)
-                    return false;
-                if(rules[1][ch - '0'])
-                    return false;
-                rules[1][ch - '0'] = 1;
-            }
-            else
-            {
-                if(rules[0][ch - '0'])
-                    return false;
-                rules[0][ch - '0'] = 1;
-            }
-        }
-        else
-            return false;
-    }
-    return true;
-}
-
-CellType eval(CellType nxny, CellType nxcy, CellType nxpy,
-              CellType cxny, CellType cxcy, CellType cxpy,
-              CellType pxny, CellType pxcy, CellType pxpy)
-{
-    size_t count = 0;
-
-    if(nxny != 0)
-    {
-        count++;
-    }
-
-    if(nxcy != 0)
-    {
-        count++;
-    }
-
-    if(nxpy != 0)
-    {
-        count++;
-    }
-
-    if(cxpy != 0)
-    {
-        count++;
-    }
-
-    if(pxpy != 0)
-    {
-        count++;
-    }
-
-    if(pxcy != 0)
-    {
-        count++;
-    }
-
-    if(pxny != 0)
-    {
-        count++;
-    }
-
-    if(cxny != 0)
-    {
-        count++;
-    }
-
-    if(cxcy != 0)
-    {
-        return rules[1][count];
-    }
-
-    return rules[0][count];
-}
-
-struct NodeGCHashTable;
-struct NodeType;
-
-class NodeReference
-{
-private:
-    const NodeType *node;
-    void incRefCount();
-    void decRefCount();
-    NodeReference(const NodeType *node, bool doIncrementRefcount)
-        : node(node)
-    {
-        if(doIncrementRefcount && node != nullptr)
-        {
-            incRefCount();
-        }
-    }
-public:
-    NodeReference(const NodeType *node = nullptr)
-        : NodeReference(node, true)
-    {
-    }
-    NodeReference(const NodeReference &rt)
-        : NodeReference(rt.node, true)
-    {
-    }
-    NodeReference(NodeReference &&rt)
-        : node(rt.node)
-    {
-        rt.node = nullptr;
-    }
-    const NodeReference &operator =(const NodeReference &rt)
-    {
-        if(rt.node == node)
-        {
-            return *this;
-        }
-
-        if(node != nullptr)
-        {
-            decRefCount();
-        }
-
-        node = rt.node;
-
-        if(node != nullptr)
-        {
-            incRefCount();
-        }
-
-        return *this;
-    }
-    const NodeReference &operator =(NodeReference && rt)
-    {
-        const NodeType *temp = rt.node;
-        rt.node = node;
-        node = temp;
-        return *this;
-    }
-    ~NodeReference()
-    {
-        if(node)
-        {
-            decRefCount();
-        }
-    }
-    operator const NodeType *() const
-    {
-        return node;
-    }
-    operator bool() const
-    {
-        return node != nullptr;
-    }
-    bool operator !() const
-    {
-        return node == nullptr;
-    }
-    const NodeType *operator ->() const
-    {
-        return node;
-    }
-    const NodeType &operator *() const
-    {
-        return *node;
-    }
-    friend bool operator ==(const NodeReference &a, std::nullptr_t)
-    {
-        return a.node == nullptr;
-    }
-    friend bool operator ==(std::nullptr_t, const NodeReference &b)
-    {
-        return b.node == nullptr;
-    }
-    friend bool operator !=(const NodeReference &a, std::nullptr_t)
-    {
-        return a.node != nullptr;
-    }
-    friend bool operator !=(std::nullptr_t, const NodeReference &b)
-    {
-        return b.node != nullptr;
-    }
-    friend bool operator ==(const NodeReference &a, const NodeType *b)
-    {
-        return a.node == b;
-    }
-    friend bool operator ==(const NodeType *a, const NodeReference &b)
-    {
-        return b.node == a;
-    }
-    friend bool operator !=(const NodeReference &a, const NodeType *b)
-    {
-        return a.node != b;
-    }
-    friend bool operator !=(const NodeType *a, const NodeReference &b)
-    {
-        return b.node != a;
-    }
-    friend bool operator ==(const NodeReference &a, const NodeReference &b)
-    {
-        return a.node == b.node;
-    }
-    friend bool operator !=(const NodeReference &a, const NodeReference &b)
-    {
-        return a.node != b.node;
-    }
-    const NodeType *detach()
-    {
-        const NodeType *retval = node;
-        node = nullptr;
-        return retval;
-    }
-    static NodeReference attach(const NodeType *node)
-    {
-        return NodeReference(node, false);
-    }
-};
-
-void dump(NodeReference rootNode);
-
-inline void lock(std::initializer_list<atomic_bool *> locks)
-{
-    static size_t startDelayCount = 10000;
-    size_t startCount = 0;
-
-    for(;;)
-    {
-        bool anyLocked = false;
-
-        for(auto i = locks.begin(); i != locks.end(); i++)
-        {
-            if(**i)
-            {
-                anyLocked = true;
-                break;
-            }
-        }
-
-        if(!anyLocked)
-        {
-            bool anyLocked = false;
-
-            for(auto i = locks.begin(); i != locks.end(); i++)
-            {
-                if((*i)->exchange(true))
-                {
-                    for(auto j = locks.begin(); j != i; j++)
-                    {
-                        **j = false;
-                    }
-
-                    anyLocked = true;
-                    break;
-                }
-            }
-
-            if(!anyLocked)
-            {
-                return;
-            }
-        }
-
-        if(startCount < startDelayCount)
-        {
-            startCount++;
-        }
-        else
-        {
-            std::this_thread::yield();
-        }
-    }
-}
-
-inline void lock(atomic_bool &theLock)
-{
-    lock(initializer_list<atomic_bool *> {&theLock});
-}
-
-inline void unlock(atomic_bool &theLock)
-{
-    theLock = false;
-}
-
-class NodeWeakReference
-{
-    friend struct NodeType;
-private:
-    mutable const NodeType *node;
-    mutable const NodeWeakReference *listNext;
-    mutable const NodeWeakReference *listPrev;
-    mutable atomic_bool locked; // always lock starting from the front-most element
-    void add();
-    void remove();
-public:
-    NodeWeakReference(const NodeType *node = nullptr)
-        : node(node), locked(false)
-    {
-        add();
-    }
-    NodeWeakReference(NodeReference node)
-        : NodeWeakReference((const NodeType *)node)
-    {
-    }
-    ~NodeWeakReference()
-    {
-        remove();
-    }
-    NodeWeakReference(const NodeWeakReference &rt)
-        : locked(false)
-    {
-        lock(rt.locked);
-        node = rt.node;
-        unlock(rt.locked);
-        add();
-    }
-    const NodeWeakReference &operator =(const NodeWeakReference &rt)
-    {
-        lock(initializer_list<atomic_bool *> {&rt.locked, &locked});
-
-        if(node == rt.node)
-        {
-            unlock(locked);
-            unlock(rt.locked);
-            return *this;
-        }
-
-        const NodeType *newNode = rt.node;
-        unlock(locked);
-        unlock(rt.locked);
-        remove();
-        lock(locked);
-        node = newNode;
-        unlock(locked);
-        add();
-        return *this;
-    }
-    const NodeWeakReference &operator =(const NodeType *newNode)
-    {
-        lock(locked);
-
-        if(node == newNode)
-        {
-            unlock(locked);
-            return *this;
-        }
-
-        unlock(locked);
-        remove();
-        lock(locked);
-        node = newNode;
-        unlock(locked);
-        add();
-        return *this;
-    }
-    const NodeWeakReference &operator =(NodeReference newNode)
-    {
-        return operator =((const NodeType *)newNode);
-    }
-    NodeReference get() const;
-};
-
-struct NodeType
-{
-    NodeType(const NodeType &) = delete;
-    const NodeType &operator =(const NodeType &) = delete;
-    mutable atomic_uint_least8_t refcount;
-    mutable uint_least8_t gcFlags = 0;
-    static constexpr uint_least8_t UsedFlag = 0x1;
-    bool used() const
-    {
-        return gcFlags & UsedFlag;
-    }
-    void used(bool v) const
-    {
-        if(v)
-        {
-            gcFlags |= UsedFlag;
-        }
-        else
-        {
-            gcFlags &= ~UsedFlag;
-        }
-    }
-    mutable const NodeType *hashNext = nullptr;
-    mutable const NodeType *gcNext = nullptr;  // pointer for gc uses
-    mutable const NodeWeakReference *weakListHead = nullptr;
-    mutable atomic_bool weakListHeadLocked;
-    mutable atomic_bool removing, testingForRemove;
-    mutable atomic_size_t weakGetCount;
-    CellColorDescriptor overallCellColorDescriptor;
-    const size_t level;
-    union SectionType
-    {
-        CellType leaf;
-        const NodeType *nonleaf;
-        SectionType(CellType leaf)
-            : leaf(leaf)
-        {
-        }
-        SectionType(const NodeType *nonleaf)
-            : nonleaf(nonleaf)
-        {
-        }
-    };
-    SectionType nxny;
-    SectionType nxpy;
-    SectionType pxny;
-    SectionType pxpy;
-    mutable NodeWeakReference nonleaf_nextState;
-    mutable size_t nextStateLogStep;
-    NodeType(CellType nxny, CellType nxpy, CellType pxny, CellType pxpy)
-        : refcount(0), weakListHeadLocked(false), removing(false), testingForRemove(false), weakGetCount(0),
-          level(0), nxny(nxny), nxpy(nxpy), pxny(pxny), pxpy(pxpy), nonleaf_nextState(nullptr), nextStateLogStep(0)
-    {
-        overallCellColorDescriptor = combineCellColorDescriptors(
-                                         initializer_list<CellColorDescriptor>
-        {
-            getCellColorDescriptor(nxny),
-            getCellColorDescriptor(nxpy),
-            getCellColorDescriptor(pxny),
-            getCellColorDescriptor(pxpy)
-        });
-    }
-    NodeType(const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny, const NodeType *pxpy)
-        : refcount(0), weakListHeadLocked(false), removing(false), testingForRemove(false), weakGetCount(0),
-          level(1 + nxny->level), nxny(nxny), nxpy(nxpy), pxny(pxny), pxpy(pxpy), nonleaf_nextState(nullptr), nextStateLogStep(nxny->level)
-    {
-        overallCellColorDescriptor = combineCellColorDescriptors(
-                                         initializer_list<CellColorDescriptor>
-        {
-            nxny->overallCellColorDescriptor,
-            nxpy->overallCellColorDescriptor,
-            pxny->overallCellColorDescriptor,
-            pxpy->overallCellColorDescriptor,
-        });
-    }
-    ~NodeType()
-    {
-        removing = true;
-        // nullify all weak references
-        lock(weakListHeadLocked);
-        const NodeWeakReference *node = weakListHead;
-
-        while(node != nullptr)
-        {
-            lock(node->locked);
-            const NodeWeakReference *nextNode = node->listNext;
-            node->node = nullptr;
-            node->listPrev = nullptr;
-            node->listNext = nullptr;
-            unlock(node->locked);
-            node = nextNode;
-        }
-    }
-    NodeReference getNextState(NodeGCHashTable *gc) const;
-    NodeReference getNextState(NodeGCHashTable *gc, size_t logStepSize) const;
-    NodeReference getCenter(NodeGCHashTable *gc) const;
-};
-
-inline void NodeReference::incRefCount()
-{
-    node->refcount++;
-}
-
-inline void NodeReference::decRefCount()
-{
-    node->refcount--;
-}
-
-inline void NodeWeakReference::add()
-{
-    lock(locked);
-    listPrev = nullptr;
-    listNext = nullptr;
-
-    if(node != nullptr)
-    {
-        lock(node->weakListHeadLocked);
-
-        if(node->weakListHead != nullptr)
-        {
-            lock(node->weakListHead->locked);
-            node->weakListHead->listPrev = this;
-            unlock(node->weakListHead->locked);
-        }
-
-        listNext = node->weakListHead;
-        node->weakListHead = this;
-        unlock(locked);
-        unlock(node->weakListHeadLocked);
-    }
-    else
-    {
-        unlock(locked);
-    }
-}
-
-inline void NodeWeakReference::remove()
-{
-    lock(locked);
-
-    if(node == nullptr)
-    {
-        unlock(locked);
-        return;
-    }
-
-    const NodeWeakReference *prev = listPrev;
-    unlock(locked);
-
-    for(;;)
-    {
-        // must lock in order
-        atomic_bool *const pPrevLock = (prev == nullptr ? &node->weakListHeadLocked : &prev->locked);
-
-        if(prev == nullptr)
-        {
-            lock(node->weakListHeadLocked);
-        }
-        else
-        {
-            lock(prev->locked);
-        }
-
-        lock(locked);
-
-        if(prev != listPrev) // check for change while unlocked
-        {
-            unlock(locked);
-            unlock(*pPrevLock);
-            continue;
-        }
-
-        if(listPrev != nullptr)
-        {
-            listPrev->listNext = listNext;
-        }
-        else
-        {
-            node->weakListHead = listNext;
-        }
-
-        if(listNext != nullptr)
-        {
-            lock(listNext->locked);
-            listNext->listPrev = listPrev;
-            unlock(listNext->locked);
-        }
-
-        unlock(locked);
-        unlock(*pPrevLock);
-        break;
-    }
-}
-
-inline NodeReference NodeWeakReference::get() const
-{
-    lock(locked);
-
-    if(node == nullptr)
-    {
-        unlock(locked);
-        return NodeReference(nullptr);
-    }
-
-    node->weakGetCount++;
-
-    while(node->testingForRemove)
-    {
-        node->weakGetCount--;
-
-        while(node->testingForRemove)
-        {
-            std::this_thread::yield();
-        }
-
-        node->weakGetCount++;
-    }
-
-    NodeReference retval(node);
-    node->weakGetCount--;
-
-    if(node->removing)
-    {
-        unlock(locked);
-        return nullptr;
-    }
-
-    unlock(locked);
-    return retval;
-}
-
-inline size_t hashNodeLeaf(CellType nxny, CellType nxpy, CellType pxny, CellType pxpy)
-{
-    size_t retval = 3;
-    std::hash<CellType> hasher;
-    retval += hasher(nxny) + 9 * hasher(nxpy) + (9 * 9) * hasher(pxny) + (9 * 9 * 9) * hasher(pxpy);
-    return retval;
-}
-
-inline size_t hashNodeNonleaf(const NodeType *nxny, const NodeType *nxpy, const NodeType *pxny,
-                const NodeType *pxpy)
-{
-    size_t retval = 0;
-    std::hash<const NodeType *> hasher;
-    retval += hasher(nxny) + 9 * hasher(nxpy) + (9 * 9) * hasher(pxny) + (9 * 9 * 9) * hasher(pxpy);
-    return retval;
-}
-
-namespace std
-{
-template<>
-struct hash<NodeType>
+// steps the game state on a background thread and publishes every finished state,
+// so the viewer keeps drawing the last published state while the next one is computed
+class SimulationWorker
 {
-    size_t operator()(const NodeType &node) const
-    {
-        if(node.level == 0)
-        {
-            return hashNodeLeaf(node.nxny.leaf, node.nxpy.leaf, node.pxny.leaf, node.pxpy.leaf);
-        }
-
-        return hashNodeNonleaf(node.nxny.nonleaf, node.nxpy.nonleaf, node.pxny.nonleaf, node.pxpy.nonleaf);
-    }
-};
-
-template <>
-struct hash<NodeReference>
-{
-    hash<const NodeType *> hasher;
-    size_t operator()(const NodeReference & node) const
-    {
-        return hasher((const NodeType *)node);
-    }
-};
-}
-
-struct NodeGCHashTable
-{
-    static constexpr size_t hashPrime = 1008863;
-    const NodeType *table[hashPrime];
-    std::mutex tableLocks[hashPrime];
-    atomic_size_t nodeCount;
-    atomic_bool runningGC;
-    NodeGCHashTable()
-        : nodeCount(0), runningGC(false)
-    {
-        for(const NodeType  *&node : table)
-        {
-            node = nullptr;
-        }
-    }
-    NodeGCHashTable(const NodeGCHashTable &) = delete;
-    const NodeGCHashTable &operator =(const NodeGCHashTable &) = delete;
-    ~NodeGCHashTable()
-    {
-        for(size_t i = 0; i < hashPrime; i++)
-        {
-            const NodeType *node;
-            {
-                std::lock_guard<std::mutex> lock(tableLocks[i]);
-                node = table[i];
-                table[i] = nullptr;
-            }
-
-            while(node != nullptr)
-            {
-                NodeType *deleteMe = (NodeType *)node;
-                node = node->hashNext;
-                deleteMe->removing = true;
-                delete deleteMe;
-            }
-        }
-    }
+    SimulationWorker(const SimulationWorker &) = delete;
+    const SimulationWorker &operator =(const SimulationWorker &) = delete;
 private:
-    const NodeType *clearAllNodes()
-    {
-        const NodeType *usedListHead = nullptr;
-
-        for(size_t i = 0; i < hashPrime; i++)
-        {
-            std::lock_guard<std::mutex> lock(tableLocks[i]);
-            const NodeType *node = table[i];
-
-            while(node != nullptr)
-            {
-                bool used = (node->refcount > 0);
-                node->used(used);
-
-                if(used)
-                {
-                    node->gcNext = usedListHead;
-                    usedListHead = node;
-                }
-
-                node = node->hashNext;
-            }
-        }
-
-        return usedListHead;
-    }
-    void markNode(const NodeType *node)
-    {
-        if(node->used())
-        {
-            return;
-        }
-
-        node->used(true);
-
-        if(node->level > 0)
-        {
-            markNode(node->nxny.nonleaf);
-            markNode(node->nxpy.nonleaf);
-            markNode(node->pxny.nonleaf);
-            markNode(node->pxpy.nonleaf);
-        }
-    }
-    void markAllNodes(const NodeType *usedListHead)
-    {
-        while(usedListHead != nullptr)
-        {
-            const NodeType *node = usedListHead;
-            usedListHead = usedListHead->gcNext;
-            node->gcNext = nullptr;
-            node->used(true);
-
-            if(node->level > 0)
-            {
-                markNode(node->nxny.nonleaf);
-                markNode(node->nxpy.nonleaf);
-                markNode(node->pxny.nonleaf);
-                markNode(node->pxpy.nonleaf);
-            }
-        }
-    }
-    void sweepUnusedNodes()
-    {
-        for(size_t i = 0; i < hashPrime; i++)
-        {
-            std::lock_guard<std::mutex> lock(tableLocks[i]);
-            const NodeType **pnode = &table[i];
-            const NodeType *node = *pnode;
-
-            while(node != nullptr)
-            {
-                bool used = node->used();
-
-                if(!used)
-                {
-                    node->testingForRemove = true;
-
-                    while(node->weakGetCount > 0)
-                    {
-                        std::this_thread::yield();
-                    }
-
-                    if(node->refcount > 0)
-                    {
-                        used = true;
-                    }
-                    else
-                    {
-                        node->removing = true;
-                    }
-
-                    node->testingForRemove = false;
-                }
-
-                if(used)
-                {
-                    pnode = &node->hashNext;
-                    node = *pnode;
-                }
-                else
-                {
-                    NodeType *deleteMe = (NodeType *)node;
-                    *pnode = node->hashNext;
-                    nodeCount--;
-                    node = *pnode;
-                    delete deleteMe;
-                }
-            }
-        }
-    }
-    void gc()
-    {
-        markAllNodes(clearAllNodes());
-        sweepUnusedNodes();
-    }
-    void onAllocate()
-    {
-        if(nodeCount > startGCNodeCount)
-        {
-            if(runningGC.exchange(true))
-            {
-                while(nodeCount > maxNodeCount && runningGC)
-                {
-                    std::this_thread::yield();
-                }
-            }
-            else
-            {
-                gc();
-                runningGC = false;
-            }
-            if(nodeCount > maxNodeCount)
-            {
-                cerr << "out of memory" << endl;
-                exit(1);
-            }
-        }
-    }
-public:
-    NodeReference findOrInsertLeaf(CellType nxny, CellType nxpy, CellType pxny, CellType pxpy)
+    std::mutex theLock;
+    condition_variable cond;
+    GameState published;
+    struct QueuedStep
     {
-        onAllocate();
-        size_t hash = hashNodeLeaf(nxny, nxpy, pxny, pxpy) % hashPrime;
-        lock_guard<std::mutex> lock(tableLocks[hash]);
-        const NodeType **pnode = &table[hash];
-        const NodeType *node = *pnode;
-
-        while(node != nullptr)
+        bool isAdvance;
+        size_t logStepSize;
+        BigUnsigned generationCount;
+        bool run(GameState & gs, StepControl *control) const
         {
-            if(node->level == 0 &&
-                    node->nxny.leaf == nxny &&
-                    node->nxpy.leaf == nxpy &&
-                    node->pxny.leaf == pxny &&
-                    node->pxpy.leaf == pxpy)
-            {
-                *pnode = node->hashNext;
-                node->hashNext = table[hash];
-                table[hash] = node;
-                return NodeReference(node);
-            }
-
-            pnode = &node->hashNext;
-            node = *pnode;
+            if(isAdvance)
+                return gs.advance(generationCount, control);
+            return gs.step(logStepSize, control);
         }
-
-        nodeCount++;
-        node = new NodeType(nxny, nxpy, pxny, pxpy);
-        node->hashNext = table[hash];
-        table[hash] = node;
-        return NodeReference(node);
-    }
-    NodeReference findOrInsertNonleaf(NodeReference nxny, NodeReference nxpy, NodeReference pxny,
-                               NodeReference pxpy)
+    };
+    deque<QueuedStep> queuedSteps;
+    bool stepping = false;
+    bool done = false;
+    bool autoStepping = false; // keeps stepping with tuned step sizes while nothing is queued
+    StepControl control;
+    const function<void()> onPublish; // called on the worker thread
+    StepSizeTuner tuner;
+    GameHistory history; // of the published states
+    uint64_t rewindCount = 0; // so a step started before a rewind isn't published
+#ifndef __EMSCRIPTEN__
+    thread workerThread;
+    void run()
     {
-        onAllocate();
-        size_t hash = hashNodeNonleaf(nxny, nxpy, pxny, pxpy) % hashPrime;
-        lock_guard<std::mutex> lock(tableLocks[hash]);
-        const NodeType **pnode = &table[hash];
-        const NodeType *node = *pnode;
-
-        while(node != nullptr)
+        unique_lock<std::mutex> lockIt(theLock);
+        for(;;)
         {
-            if(node->level > 0 &&
-                    node->nxny.nonleaf == nxny &&
-                    node->nxpy.nonleaf == nxpy &&
-                    node->pxny.nonleaf == pxny &&
-                    node->pxpy.nonleaf == pxpy)
+            while(queuedSteps.empty() && !autoStepping && !done)
+                cond.wait(lockIt);
+            if(done)
+                return;
+            bool isAutoStep = queuedSteps.empty();
+            QueuedStep queuedStep;
+            if(!isAutoStep)
             {
-                *pnode = node->hashNext;
-                node->hashNext = table[hash];
-                table[hash] = node;
-                return NodeReference(node);
+                queuedStep = queuedSteps.front();
+                queuedSteps.pop_front();
             }
-
-            pnode = &node->hashNext;
-            node = *pnode;
+            GameState gs = published;
+            uint64_t startRewindCount = rewindCount;
+            stepping = true;
+            control.cancelled = false;
+            lockIt.unlock();
+            bool finished = isAutoStep ? tuner.step(gs, &control) : queuedStep.run(gs, &control);
+            lockIt.lock();
+            stepping = false;
+            if(!finished || rewindCount != startRewindCount)
+                continue;
+            published = gs;
+            history.record(published);
+            lockIt.unlock();
+            gs = GameState(nullptr);
+            if(onPublish)
+                onPublish();
+            lockIt.lock();
         }
-
-        nodeCount++;
-        node = new NodeType((const NodeType *)nxny, (const NodeType *)nxpy, (const NodeType *)pxny, (const NodeType *)pxpy);
-        node->hashNext = table[hash];
-        table[hash] = node;
-        return NodeReference(node);
     }
-private:
-    vector<vector<NodeReference>> nullNodes;
-    atomic_bool nullNodesLocked;
+#endif // __EMSCRIPTEN__
 public:
-    NodeReference getNullNode(size_t level, CellType backgroundType)
-    {
-        lock(nullNodesLocked);
-        if(backgroundType >= nullNodes.size())
-            nullNodes.resize(backgroundType + 1);
-        if(level < nullNodes[backgroundType].size())
-        {
-            unlock(nullNodesLocked);
-            return nullNodes[backgroundType][level];
-        }
-        NodeReference retval;
-        for(size_t i = nullNodes[backgroundType].size(); i <= level; i++)
-        {
-            if(i == 0)
-            {
-                retval = findOrInsertLeaf(backgroundType, backgroundType, backgroundType, backgroundType);
-            }
-            else
-            {
-                NodeReference prevNullNode = nullNodes[backgroundType][i - 1];
-                retval = findOrInsertNonleaf(prevNullNode, prevNullNode, prevNullNode, prevNullNode);
-            }
-            nullNodes[backgroundType].push_back(retval);
-        }
-        unlock(nullNodesLocked);
-        return retval;
-    }
-    NodeReference make4x4(CellType n2xn2y, CellType nxn2y, CellType cxn2y, CellType pxn2y,
-                          CellType n2xny, CellType nxny, CellType cxny, CellType pxny,
-                          CellType n2xcy, CellType nxcy, CellType cxcy, CellType pxcy,
-                          CellType n2xpy, CellType nxpy, CellType cxpy, CellType pxpy)
-    {
-        return findOrInsertNonleaf(findOrInsertLeaf(n2xn2y, n2xny, nxn2y, nxny),
-                                findOrInsertLeaf(n2xcy, n2xpy, nxcy, nxpy),
-                                findOrInsertLeaf(cxn2y, cxny, pxn2y, pxny),
-                                findOrInsertLeaf(cxcy, cxpy, pxcy, pxpy));
-    }
-};
-
-CellType getCell(NodeReference rootNode, int x, int y);
-
-NodeReference NodeType::getCenter(NodeGCHashTable *gc) const
-{
-    NodeReference thisRef = this;
-    if(level == 0)
-    {
-        assert(false);
-        return nullptr;
-    }
-    else if(level == 1)
-        return gc->findOrInsertLeaf(nxny.nonleaf->pxpy.leaf, nxpy.nonleaf->pxny.leaf, pxny.nonleaf->nxpy.leaf, pxpy.nonleaf->nxny.leaf);
-    else
-        return gc->findOrInsertNonleaf(nxny.nonleaf->pxpy.nonleaf, nxpy.nonleaf->pxny.nonleaf, pxny.nonleaf->nxpy.nonleaf, pxpy.nonleaf->nxny.nonleaf);
-}
-
-NodeReference NodeType::getNextState(NodeGCHashTable *gc) const
-{
-    NodeReference thisRef = this;
-    NodeReference retval = nonleaf_nextState.get();
-
-    if(retval != nullptr && nextStateLogStep + 1 == level)
-    {
-        return retval;
-    }
-
-    if(level == 0)
-    {
-        assert(false);
-        return nullptr;
-    }
-    else if(level == 1)
-    {
-        CellType new_nxny = eval(nxny.nonleaf->nxny.leaf, nxny.nonleaf->nxpy.leaf, nxpy.nonleaf->nxny.leaf,
-                                 nxny.nonleaf->pxny.leaf, nxny.nonleaf->pxpy.leaf, nxpy.nonleaf->pxny.leaf,
-                                 pxny.nonleaf->nxny.leaf, pxny.nonleaf->nxpy.leaf, pxpy.nonleaf->nxny.leaf);
-        CellType new_nxpy = eval(nxny.nonleaf->nxpy.leaf, nxpy.nonleaf->nxny.leaf, nxpy.nonleaf->nxpy.leaf,
-                                 nxny.nonleaf->pxpy.leaf, nxpy.nonleaf->pxny.leaf, nxpy.nonleaf->pxpy.leaf,
-                                 pxny.nonleaf->nxpy.leaf, pxpy.nonleaf->nxny.leaf, pxpy.nonleaf->nxpy.leaf);
-        CellType new_pxny = eval(nxny.nonleaf->pxny.leaf, nxny.nonleaf->pxpy.leaf, nxpy.nonleaf->pxny.leaf,
-                                 pxny.nonleaf->nxny.leaf, pxny.nonleaf->nxpy.leaf, pxpy.nonleaf->nxny.leaf,
-                                 pxny.nonleaf->pxny.leaf, pxny.nonleaf->pxpy.leaf, pxpy.nonleaf->pxny.leaf);
-        CellType new_pxpy = eval(nxny.nonleaf->pxpy.leaf, nxpy.nonleaf->pxny.leaf, nxpy.nonleaf->pxpy.leaf,
-                                 pxny.nonleaf->nxpy.leaf, pxpy.nonleaf->nxny.leaf, pxpy.nonleaf->nxpy.leaf,
-                                 pxny.nonleaf->pxpy.leaf, pxpy.nonleaf->pxny.leaf, pxpy.nonleaf->pxpy.leaf);
-        retval = gc->findOrInsertLeaf(new_nxny, new_nxpy, new_pxny, new_pxpy);
-    }
-    else
-    {
-        NodeReference step1_nxny = nxny.nonleaf->getNextState(gc);
-        NodeReference step1_nxpy = nxpy.nonleaf->getNextState(gc);
-        NodeReference step1_pxny = pxny.nonleaf->getNextState(gc);
-        NodeReference step1_pxpy = pxpy.nonleaf->getNextState(gc);
-        NodeReference step1_nxcy = gc->findOrInsertNonleaf(nxny.nonleaf->nxpy.nonleaf, nxpy.nonleaf->nxny.nonleaf, nxny.nonleaf->pxpy.nonleaf, nxpy.nonleaf->pxny.nonleaf)->getNextState(gc);
-        NodeReference step1_pxcy = gc->findOrInsertNonleaf(pxny.nonleaf->nxpy.nonleaf, pxpy.nonleaf->nxny.nonleaf, pxny.nonleaf->pxpy.nonleaf, pxpy.nonleaf->pxny.nonleaf)->getNextState(gc);
-        NodeReference step1_cxny = gc->findOrInsertNonleaf(nxny.nonleaf->pxny.nonleaf, nxny.nonleaf->pxpy.nonleaf, pxny.nonleaf->nxny.nonleaf, pxny.nonleaf->nxpy.nonleaf)->getNextState(gc);
-        NodeReference step1_cxpy = gc->findOrInsertNonleaf(nxpy.nonleaf->pxny.nonleaf, nxpy.nonleaf->pxpy.nonleaf, pxpy.nonleaf->nxny.nonleaf, pxpy.nonleaf->nxpy.nonleaf)->getNextState(gc);
-        NodeReference step1_cxcy = gc->findOrInsertNonleaf(nxny.nonleaf->pxpy.nonleaf, nxpy.nonleaf->pxny.nonleaf, pxny.nonleaf->nxpy.nonleaf, pxpy.nonleaf->nxny.nonleaf)->getNextState(gc);
-        NodeReference final_nxny = gc->findOrInsertNonleaf(step1_nxny, step1_nxcy, step1_cxny, step1_cxcy)->getNextState(gc);
-        NodeReference final_nxpy = gc->findOrInsertNonleaf(step1_nxcy, step1_nxpy, step1_cxcy, step1_cxpy)->getNextState(gc);
-        NodeReference final_pxny = gc->findOrInsertNonleaf(step1_cxny, step1_cxcy, step1_pxny, step1_pxcy)->getNextState(gc);
-        NodeReference final_pxpy = gc->findOrInsertNonleaf(step1_cxcy, step1_cxpy, step1_pxcy, step1_pxpy)->getNextState(gc);
-        retval = gc->findOrInsertNonleaf(final_nxny, final_nxpy, final_pxny, final_pxpy);
-    }
-
-    nonleaf_nextState = retval;
-    nextStateLogStep = level - 1;
-    return retval;
-}
-
-NodeReference NodeType::getNextState(NodeGCHashTable *gc, size_t logStepSize) const
-{
-    NodeReference thisRef = this;
-    assert(level >= logStepSize + 1);
-    if(logStepSize == level - 1)
-        return getNextState(gc);
-    NodeReference retval = nonleaf_nextState.get();
-    if(retval != nullptr && nextStateLogStep == logStepSize)
-        return retval;
-    NodeReference step1_nxny = nxny.nonleaf->getNextState(gc, logStepSize);
-    NodeReference step1_nxpy = nxpy.nonleaf->getNextState(gc, logStepSize);
-    NodeReference step1_pxny = pxny.nonleaf->getNextState(gc, logStepSize);
-    NodeReference step1_pxpy = pxpy.nonleaf->getNextState(gc, logStepSize);
-    NodeReference step1_nxcy = gc->findOrInsertNonleaf(nxny.nonleaf->nxpy.nonleaf, nxpy.nonleaf->nxny.nonleaf, nxny.nonleaf->pxpy.nonleaf, nxpy.nonleaf->pxny.nonleaf)->getNextState(gc, logStepSize);
-    NodeReference step1_pxcy = gc->findOrInsertNonleaf(pxny.nonleaf->nxpy.nonleaf, pxpy.nonleaf->nxny.nonleaf, pxny.nonleaf->pxpy.nonleaf, pxpy.nonleaf->pxny.nonleaf)->getNextState(gc, logStepSize);
-    NodeReference step1_cxny = gc->findOrInsertNonleaf(nxny.nonleaf->pxny.nonleaf, nxny.nonleaf->pxpy.nonleaf, pxny.nonleaf->nxny.nonleaf, pxny.nonleaf->nxpy.nonleaf)->getNextState(gc, logStepSize);
-    NodeReference step1_cxpy = gc->findOrInsertNonleaf(nxpy.nonleaf->pxny.nonleaf, nxpy.nonleaf->pxpy.nonleaf, pxpy.nonleaf->nxny.nonleaf, pxpy.nonleaf->nxpy.nonleaf)->getNextState(gc, logStepSize);
-    NodeReference step1_cxcy = gc->findOrInsertNonleaf(nxny.nonleaf->pxpy.nonleaf, nxpy.nonleaf->pxny.nonleaf, pxny.nonleaf->nxpy.nonleaf, pxpy.nonleaf->nxny.nonleaf)->getNextState(gc, logStepSize);
-    NodeReference final_nxny = gc->findOrInsertNonleaf(step1_nxny, step1_nxcy, step1_cxny, step1_cxcy)->getCenter(gc);
-    NodeReference final_nxpy = gc->findOrInsertNonleaf(step1_nxcy, step1_nxpy, step1_cxcy, step1_cxpy)->getCenter(gc);
-    NodeReference final_pxny = gc->findOrInsertNonleaf(step1_cxny, step1_cxcy, step1_pxny, step1_pxcy)->getCenter(gc);
-    NodeReference final_pxpy = gc->findOrInsertNonleaf(step1_cxcy, step1_cxpy, step1_pxcy, step1_pxpy)->getCenter(gc);
-    retval = gc->findOrInsertNonleaf(final_nxny, final_nxpy, final_pxny, final_pxpy);
-    nonleaf_nextState = retval;
-    nextStateLogStep = logStepSize;
-    return retval;
-}
-
-inline void drawPixel(int x, int y, Color color, void *pixels, int w, int h, int pitch)
-{
-    if(x >= 0 && y >= 0 && x < w && y < h)
-    {
-        *(Color *)((char *)(pixels) + (x * sizeof(Color) + y * pitch)) = color;
-    }
-}
-
-inline void drawPixel(BigFloat x, BigFloat y, Color color, void *pixels, int w, int h, int pitch)
-{
-    if(x >= 0 && y >= 0 && x < w && y < h)
-    {
-        drawPixel((int)x, (int)y, color, pixels, w, h, pitch);
-    }
-}
-
-inline void drawSquare(int x, int y, int size, Color color, void *pixels, int w, int h, int pitch)
-{
-    for(int ry = max(0, -y); ry < size && ry + y < h; ry++)
+    SimulationWorker(GameState initialState, function<void()> onPublish = nullptr, double targetStepSeconds = 0.1)
+        : published(initialState), onPublish(onPublish), tuner(targetStepSeconds)
     {
-        for(int rx = max(0, -x); rx < size && rx + x < w; rx++)
+        history.record(published);
+#ifndef __EMSCRIPTEN__
+        workerThread = thread([this]()
         {
-            drawPixel(x + rx, y + ry, color, pixels, w, h, pitch);
-        }
-    }
-}
-
-inline void drawSquare(BigFloat x, BigFloat y, BigFloat size, Color color, void *pixels, int w, int h, int pitch)
-{
-    if(x + size < 0 || x >= w)
-        return;
-    if(y + size < 0 || y >= h)
-        return;
-    BigFloat xSize = size;
-    BigFloat ySize = size;
-    if(x < 0)
-    {
-        xSize += x;
-        x = 0;
-    }
-    if(y < 0)
-    {
-        ySize += y;
-        y = 0;
-    }
-    if(x + xSize > w - 1)
-    {
-        xSize = w - 1 - x;
-    }
-    if(y + ySize > h - 1)
-    {
-        ySize = h - 1 - y;
-    }
-    drawSquare((int)x, (int)y, (int)max(xSize, ySize), color, pixels, w, h, pitch);
-}
-
-void drawNode(NodeReference node, BigFloat centerX, BigFloat centerY, int logSize, void *pixels, int w, int h, int pitch)
-{
-    if(logSize <= 0)
-    {
-        drawPixel(centerX, centerY, getCellColorDescriptorColor(node->overallCellColorDescriptor), pixels, w, h, pitch);
-        return;
-    }
-    if(node->level == 0)
-    {
-        assert(logSize > 0);
-        BigFloat pixelSize = ldexp(1_bf, logSize - 1);
-        drawSquare(centerX - pixelSize, centerY - pixelSize, pixelSize, getCellColorDescriptorColor(getCellColorDescriptor(node->nxny.leaf)), pixels, w, h, pitch);
-        drawSquare(centerX - pixelSize, centerY, pixelSize, getCellColorDescriptorColor(getCellColorDescriptor(node->nxpy.leaf)), pixels, w, h, pitch);
-        drawSquare(centerX, centerY - pixelSize, pixelSize, getCellColorDescriptorColor(getCellColorDescriptor(node->pxny.leaf)), pixels, w, h, pitch);
-        drawSquare(centerX, centerY, pixelSize, getCellColorDescriptorColor(getCellColorDescriptor(node->pxpy.leaf)), pixels, w, h, pitch);
-        return;
-    }
-    BigFloat subNodeSize = ldexp(1_bf, logSize - 1);
-    BigFloat halfSubNodeSize = subNodeSize / 2;
-    if(centerX + subNodeSize <= 0 || centerY + subNodeSize <= 0 || centerX - subNodeSize > w || centerY - subNodeSize > h)
-        return;
-    drawNode(node->nxny.nonleaf, centerX - halfSubNodeSize, centerY - halfSubNodeSize, logSize - 1, pixels, w, h, pitch);
-    drawNode(node->nxpy.nonleaf, centerX - halfSubNodeSize, centerY + halfSubNodeSize, logSize - 1, pixels, w, h, pitch);
-    drawNode(node->pxny.nonleaf, centerX + halfSubNodeSize, centerY - halfSubNodeSize, logSize - 1, pixels, w, h, pitch);
-    drawNode(node->pxpy.nonleaf, centerX + halfSubNodeSize, centerY + halfSubNodeSize, logSize - 1, pixels, w, h, pitch);
-}
-
-NodeReference setCellH(NodeReference node, BigFloat centerX, BigFloat centerY, NodeGCHashTable * gc, int x, int y, CellType newCell)
-{
-    BigFloat subNodeSize = ldexp(1_bf, node->level);
-    if(x < centerX - subNodeSize || x >= centerX + subNodeSize || y < centerY - subNodeSize || y >= centerY + subNodeSize)
-        assert(false);
-    if(node->level == 0)
-    {
-        CellType nxny = node->nxny.leaf;
-        CellType nxpy = node->nxpy.leaf;
-        CellType pxny = node->pxny.leaf;
-        CellType pxpy = node->pxpy.leaf;
-        if(x == centerX - 1 && y == centerY - 1)
-            nxny = newCell;
-        else if(x == centerX - 1 && y == centerY)
-            nxpy = newCell;
-        else if(x == centerX && y == centerY - 1)
-            pxny = newCell;
-        else if(x == centerX && y == centerY)
-            pxpy = newCell;
-        else
-            assert(false);
-        return gc->findOrInsertLeaf(nxny, nxpy, pxny, pxpy);
+            run();
+        });
+#endif // __EMSCRIPTEN__
     }
-    BigFloat halfSubNodeSize = subNodeSize / 2;
-    NodeReference nxny = node->nxny.nonleaf;
-    NodeReference nxpy = node->nxpy.nonleaf;
-    NodeReference pxny = node->pxny.nonleaf;
-    NodeReference pxpy = node->pxpy.nonleaf;
-    if(x < centerX)
+    ~SimulationWorker()
     {
-        if(y < centerY)
-        {
-            nxny = setCellH(nxny, centerX - halfSubNodeSize, centerY - halfSubNodeSize, gc, x, y, newCell);
-            assert(nxny != nullptr);
-        }
-        else
+#ifndef __EMSCRIPTEN__
         {
-            nxpy = setCellH(nxpy, centerX - halfSubNodeSize, centerY + halfSubNodeSize, gc, x, y, newCell);
-            assert(nxpy != nullptr);
+            lock_guard<std::mutex> lockIt(theLock);
+            done = true;
+            queuedSteps.clear();
+            control.cancel();
         }
+        cond.notify_all();
+        workerThread.join();
+#endif // __EMSCRIPTEN__
     }
-    else
+    GameState getState()
     {
-        if(y < centerY)
-        {
-            pxny = setCellH(pxny, centerX + halfSubNodeSize, centerY - halfSubNodeSize, gc, x, y, newCell);
-            assert(pxny != nullptr);
-        }
-        else
-        {
-            pxpy = setCellH(pxpy, centerX + halfSubNodeSize, centerY + halfSubNodeSize, gc, x, y, newCell);
-            assert(pxpy != nullptr);
-        }
+        lock_guard<std::mutex> lockIt(theLock);
+        return published;
     }
-    return gc->findOrInsertNonleaf(nxny, nxpy, pxny, pxpy);
-}
-
-bool isInNodeBounds(NodeReference node, BigFloat centerX, BigFloat centerY, int x, int y)
-{
-    BigFloat subNodeSize = ldexp(1_bf, node->level);
-    if(x < centerX - subNodeSize || x >= centerX + subNodeSize || y < centerY - subNodeSize || y >= centerY + subNodeSize)
-        return false;
-    return true;
-}
-
-CellType getCellH(NodeReference node, BigFloat centerX, BigFloat centerY, int x, int y)
-{
-    BigFloat subNodeSize = ldexp(1_bf, node->level);
-    if(x < centerX - subNodeSize || x >= centerX + subNodeSize || y < centerY - subNodeSize || y >= centerY + subNodeSize)
-        assert(false);
-    if(node->level == 0)
+private:
+    void queue(QueuedStep queuedStep)
     {
-        CellType nxny = node->nxny.leaf;
-        CellType nxpy = node->nxpy.leaf;
-        CellType pxny = node->pxny.leaf;
-        CellType pxpy = node->pxpy.leaf;
-        if(x == centerX - 1 && y == centerY - 1)
-            return nxny;
-        else if(x == centerX - 1 && y == centerY)
-            return nxpy;
-        else if(x == centerX && y == centerY - 1)
-            return pxny;
-        else if(x == centerX && y == centerY)
-            return pxpy;
-        else
+#ifdef __EMSCRIPTEN__
+        queuedStep.run(published, nullptr); // no threads : step in place
+        history.record(published);
+        if(onPublish)
+            onPublish();
+#else
         {
-            assert(false);
-            return 0;
+            lock_guard<std::mutex> lockIt(theLock);
+            queuedSteps.push_back(queuedStep);
         }
+        cond.notify_all();
+#endif // __EMSCRIPTEN__
     }
-    BigFloat halfSubNodeSize = subNodeSize / 2;
-    if(x < centerX)
+public:
+    void queueStep(size_t logStepSize)
     {
-        if(y < centerY)
-        {
-            NodeReference nxny = node->nxny.nonleaf;
-            return getCellH(nxny, centerX - halfSubNodeSize, centerY - halfSubNodeSize, x, y);
-        }
-        else
-        {
-            NodeReference nxpy = node->nxpy.nonleaf;
-            return getCellH(nxpy, centerX - halfSubNodeSize, centerY + halfSubNodeSize, x, y);
-        }
+        queue(QueuedStep{false, logStepSize, BigUnsigned()});
     }
-    else
+    void queueAdvance(BigUnsigned generationCount)
     {
-        if(y < centerY)
-        {
-            NodeReference pxny = node->pxny.nonleaf;
-            return getCellH(pxny, centerX + halfSubNodeSize, centerY - halfSubNodeSize, x, y);
-        }
-        else
-        {
-            NodeReference pxpy = node->pxpy.nonleaf;
-            return getCellH(pxpy, centerX + halfSubNodeSize, centerY + halfSubNodeSize, x, y);
-        }
+        queue(QueuedStep{true, 0, generationCount});
     }
-}
-
-struct GameState
-{
-    NodeGCHashTable * gc;
-    NodeReference rootNode;
-    CellType backgroundType;
-    GameState(NodeGCHashTable * gc, NodeReference rootNode = nullptr, CellType backgroundType = 0)
-        : gc(gc), rootNode(rootNode), backgroundType(backgroundType)
+    void cancelQueued()
     {
-        if(gc == nullptr)
-        {
-            this->rootNode = nullptr;
-            this->backgroundType = 0;
-            return;
-        }
-        if(rootNode == nullptr)
-            this->rootNode = gc->getNullNode(0, backgroundType);
-        assert(this->rootNode != nullptr);
+        lock_guard<std::mutex> lockIt(theLock);
+        queuedSteps.clear();
     }
-    void draw(int logSize, void *pixels, int w, int h, int pitch)
+    void cancelAll() // including the step in progress and hyperspeed mode; every result computed so far stays memoized
     {
-        assert(gc != nullptr);
-        drawSquare(0, 0, max(w, h), getCellColorDescriptorColor(getCellColorDescriptor(backgroundType)), pixels, w, h, pitch);
-        drawNode(rootNode, w / 2, h / 2, logSize + 1, pixels, w, h, pitch);
+        lock_guard<std::mutex> lockIt(theLock);
+        queuedSteps.clear();
+        autoStepping = false;
+        control.cancel();
     }
-private:
-    void expandRoot()
+    // goes back to the latest kept state before the shown one, cancelling everything like cancelAll;
+    // returns false if there is none
+    bool rewind()
     {
-        assert(gc != nullptr);
-        if(rootNode->level == 0)
         {
-            rootNode = gc->findOrInsertNonleaf(gc->findOrInsertLeaf(backgroundType, backgroundType, backgroundType, rootNode->nxny.leaf),
-                                    gc->findOrInsertLeaf(backgroundType, backgroundType, rootNode->nxpy.leaf, backgroundType),
-                                    gc->findOrInsertLeaf(backgroundType, rootNode->pxny.leaf, backgroundType, backgroundType),
-                                    gc->findOrInsertLeaf(rootNode->pxpy.leaf, backgroundType, backgroundType, backgroundType));
-        }
-        else
-        {
-            NodeReference nullNode = gc->getNullNode(rootNode->level - 1, backgroundType);
-            rootNode = gc->findOrInsertNonleaf(gc->findOrInsertNonleaf(nullNode, nullNode, nullNode, rootNode->nxny.nonleaf),
-                                    gc->findOrInsertNonleaf(nullNode, nullNode, rootNode->nxpy.nonleaf, nullNode),
-                                    gc->findOrInsertNonleaf(nullNode, rootNode->pxny.nonleaf, nullNode, nullNode),
-                                    gc->findOrInsertNonleaf(rootNode->pxpy.nonleaf, nullNode, nullNode, nullNode));
+            lock_guard<std::mutex> lockIt(theLock);
+            queuedSteps.clear();
+            autoStepping = false;
+            control.cancel();
+            GameState previous = history.getPrevious(published.generation);
+            if(!previous)
+                return false;
+            published = previous;
+            rewindCount++;
         }
+        if(onPublish)
+            onPublish();
+        return true;
     }
-public:
-    void setCell(int x, int y, CellType newCell)
+    void setAutoStep(bool autoStepping, size_t initialLogStepSize = 0)
     {
-        assert(gc != nullptr);
-        while(!isInNodeBounds(rootNode, 0, 0, x, y))
         {
-            expandRoot();
+            lock_guard<std::mutex> lockIt(theLock);
+            if(autoStepping && !this->autoStepping)
+                tuner.setLogStepSize(initialLogStepSize);
+            this->autoStepping = autoStepping;
         }
-        rootNode = setCellH(rootNode, 0, 0, gc, x, y, newCell);
+        cond.notify_all();
     }
-    CellType getCell(int x, int y)
+    bool isAutoStep()
     {
-        assert(gc != nullptr);
-        if(!isInNodeBounds(rootNode, 0, 0, x, y))
-            return backgroundType;
-        return getCellH(rootNode, 0, 0, x, y);
+        lock_guard<std::mutex> lockIt(theLock);
+        return autoStepping;
     }
-private:
-    void checkForContractRoot()
+    size_t getAutoLogStepSize() const
     {
-        assert(gc != nullptr);
-        for(;;)
-        {
-            if(rootNode->level < 2)
-            {
-                return;
-            }
-            NodeReference nullNode = gc->getNullNode(rootNode->level - 2, backgroundType);
-            if(rootNode->nxny.nonleaf->nxny.nonleaf != nullNode)
-                return;
-            if(rootNode->nxny.nonleaf->nxpy.nonleaf != nullNode)
-                return;
-            if(rootNode->nxny.nonleaf->pxny.nonleaf != nullNode)
-                return;
-            if(rootNode->nxpy.nonleaf->nxny.nonleaf != nullNode)
-                return;
-            if(rootNode->nxpy.nonleaf->nxpy.nonleaf != nullNode)
-                return;
-            if(rootNode->nxpy.nonleaf->pxpy.nonleaf != nullNode)
-                return;
-            if(rootNode->pxny.nonleaf->nxny.nonleaf != nullNode)
-                return;
-            if(rootNode->pxny.nonleaf->pxny.nonleaf != nullNode)
-                return;
-            if(rootNode->pxny.nonleaf->pxpy.nonleaf != nullNode)
-                return;
-            if(rootNode->pxpy.nonleaf->nxpy.nonleaf != nullNode)
-                return;
-            if(rootNode->pxpy.nonleaf->pxny.nonleaf != nullNode)
-                return;
-            if(rootNode->pxpy.nonleaf->pxpy.nonleaf != nullNode)
-                return;
-            rootNode = rootNode->getCenter(gc);
-        }
+        return tuner.getLogStepSize();
     }
-public:
-    void step(size_t logStepSize)
+#ifdef __EMSCRIPTEN__
+    void idle() // no threads : run one hyperspeed step per frame
+    {
+        if(!autoStepping)
+            return;
+        tuner.step(published);
+        history.record(published);
+        if(onPublish)
+            onPublish();
+    }
+#endif // __EMSCRIPTEN__
+    double getProgress() const // of the step in progress
     {
-        assert(gc != nullptr);
-        expandRoot();
-        expandRoot();
-        while(rootNode->level < logStepSize + 1)
-            expandRoot();
-        backgroundType = getCellH(gc->getNullNode(rootNode->level, backgroundType)->getNextState(gc, logStepSize), 0, 0, 0, 0);
-        rootNode = rootNode->getNextState(gc, logStepSize);
-        checkForContractRoot();
+        return control.getProgress();
     }
-    operator bool() const
+    size_t getQueuedCount()
     {
-        return gc != nullptr;
+        lock_guard<std::mutex> lockIt(theLock);
+        return queuedSteps.size();
     }
-    bool operator !() const
+    bool isStepping()
     {
-        return gc == nullptr;
+        lock_guard<std::mutex> lockIt(theLock);
+        return stepping;
     }
 };
 
-string getCellStringNoPrefix(CellType cellType)
-{
-    if(cellType)
-        return "#";
-    return "-";
-}
-
-string getCellString(CellType cellType)
-{
-    return "C" + getCellStringNoPrefix(cellType);
-}
-
-string getNodeString(int nodeIndex)
+// redraws only when the drawn state or the view changed
+class ViewRenderer
 {
-    ostringstream os;
-    os << "N" << nodeIndex;
-    return os.str();
-}
-
-vector<vector<CellType>> getNodeGraph(NodeReference node)
-{
-    if(node->level == 0)
+    ViewRenderer(const ViewRenderer &) = delete;
+    const ViewRenderer &operator =(const ViewRenderer &) = delete;
+private:
+    RenderTileCache tileCache;
+    ThreadPool *threadPool;
+    NodeReference lastRootNode;
+    CellType lastBackgroundType = 0;
+    int lastLogSize = 0, lastW = 0, lastH = 0;
+public:
+    explicit ViewRenderer(ThreadPool *threadPool = nullptr)
+        : threadPool(threadPool)
     {
-        return vector<vector<CellType>>{vector<CellType>{node->nxny.leaf, node->pxny.leaf}, vector<CellType>{node->nxpy.leaf, node->pxpy.leaf}};
     }
-    vector<vector<CellType>> nxny = getNodeGraph(node->nxny.nonleaf);
-    vector<vector<CellType>> nxpy = getNodeGraph(node->nxpy.nonleaf);
-    vector<vector<CellType>> pxny = getNodeGraph(node->pxny.nonleaf);
-    vector<vector<CellType>> pxpy = getNodeGraph(node->pxpy.nonleaf);
-    vector<vector<CellType>> retval;
-    size_t subNodeSize = (size_t)1 << node->level;
-    retval.reserve(2 * subNodeSize);
-    for(size_t y = 0; y < subNodeSize; y++)
+    bool isCurrent(const GameState & gs, int logSize, int w, int h) const
     {
-        retval.push_back(std::move(nxny[y]));
-        retval.back().reserve(2 * subNodeSize);
-        retval.back().insert(retval.back().end(), pxny[y].begin(), pxny[y].end());
+        return lastRootNode != nullptr && lastRootNode == gs.rootNode && lastBackgroundType == gs.backgroundType
+               && lastLogSize == logSize && lastW == w && lastH == h;
     }
-    for(size_t y = 0; y < subNodeSize; y++)
+    void draw(const GameState & gs, int logSize, void *pixels, int w, int h, int pitch)
     {
-        retval.push_back(std::move(nxpy[y]));
-        retval.back().reserve(2 * subNodeSize);
-        retval.back().insert(retval.back().end(), pxpy[y].begin(), pxpy[y].end());
+        gs.draw(logSize, pixels, w, h, pitch, &tileCache, threadPool);
+        lastRootNode = gs.rootNode;
+        lastBackgroundType = gs.backgroundType;
+        lastLogSize = logSize;
+        lastW = w;
+        lastH = h;
     }
-    return std::move(retval);
-}
+};
 
-string getNodeGraphAsString(NodeReference node)
+// writes checkpoints on a background thread so stepping never waits for the disk
+class CheckpointWriter
 {
-    vector<vector<CellType>> theGraph = getNodeGraph(node);
-    ostringstream os;
-    for(const vector<CellType> & line : theGraph)
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    const CheckpointWriter &operator =(const CheckpointWriter &) = delete;
+private:
+    const string fileName;
+    const chrono::steady_clock::duration interval;
+    chrono::steady_clock::time_point lastRequestTime;
+    std::mutex theLock;
+    condition_variable cond;
+    GameState pending = GameState(nullptr);
+    bool done = false;
+    thread writerThread;
+    void run()
+    {
+        unique_lock<std::mutex> lockIt(theLock);
+        for(;;)
+        {
+            while(!pending && !done)
+                cond.wait(lockIt);
+            if(!pending)
+                return;
+            GameState gs = pending;
+            pending = GameState(nullptr);
+            lockIt.unlock();
+            if(!writeCheckpoint(fileName, gs))
+                cerr << "writing checkpoint '" << fileName << "' failed" << endl;
+            gs = GameState(nullptr);
+            lockIt.lock();
+        }
+    }
+public:
+    CheckpointWriter(string fileName, chrono::steady_clock::duration interval)
+        : fileName(fileName), interval(interval), lastRequestTime(chrono::steady_clock::now())
+    {
+        writerThread = thread([this]()
+        {
+            run();
+        });
+    }
+    ~CheckpointWriter()
     {
-        string seperator = "";
-        for(CellType cell : line)
         {
-            string cellString = getCellStringNoPrefix(cell);
-            cellString.resize(2, ' ');
-            os << seperator << cellString;
-            seperator = " ";
+            lock_guard<std::mutex> lockIt(theLock);
+            done = true;
         }
-        os << "\n";
+        cond.notify_all();
+        writerThread.join();
     }
-    return os.str();
-}
+    void request(const GameState & gs)
+    {
+        lastRequestTime = chrono::steady_clock::now();
+        {
+            lock_guard<std::mutex> lockIt(theLock);
+            pending = gs;
+        }
+        cond.notify_all();
+    }
+    void stateChanged(const GameState & gs)
+    {
+        if(chrono::steady_clock::now() - lastRequestTime >= interval)
+            request(gs);
+    }
+};
 
-void dump(NodeReference rootNode)
+// renders frames and encodes them on worker threads while the caller keeps stepping, so a long frame sequence
+// takes about as long as the stepping. frames go to one file per frame when the file name has a printf
+// conversion for the frame number in it (like frame%05d.png) and otherwise one after another to the stream, in order
+class FrameExporter
 {
-    unordered_map<NodeReference, int> nodesMap;
-    int nextNodeIndex = 1;
-    vector<NodeReference> nodesList;
-    unordered_set<NodeReference> newNodesSet;
-    newNodesSet.insert(rootNode);
-    while(!newNodesSet.empty())
+    FrameExporter(const FrameExporter &) = delete;
+    const FrameExporter &operator =(const FrameExporter &) = delete;
+public:
+    struct Options
     {
-        unordered_set<NodeReference> nodesSet(std::move(newNodesSet));
-        newNodesSet.clear();
-        for(NodeReference node : nodesSet)
+        int w = 1024, h = 768;
+        int logCellSize = 0; // see GameState::drawView
+        int64_t centerX = 0, centerY = 0;
+        bool png = true; // or raw RGB
+    };
+private:
+    const string fileNamePattern; // "" to write to stream
+    ostream * const stream;
+    const Options options;
+    RenderTileCache tileCache;
+    std::mutex theLock;
+    condition_variable cond;
+    size_t submittedCount = 0, writtenCount = 0, pendingCount = 0;
+    const size_t maxPendingCount; // so stepping can't run arbitrarily far ahead of the encoding
+    map<size_t, string> encodedFrames; // waiting for the frames before them to be written
+    bool failed = false;
+    ThreadPool encoders; // last, so its threads are joined before the rest is destroyed
+    string getFileName(size_t frameIndex) const
+    {
+        vector<char> buffer(fileNamePattern.size() + 32);
+        snprintf(buffer.data(), buffer.size(), fileNamePattern.c_str(), (int)frameIndex);
+        return buffer.data();
+    }
+    void encode(const GameState & gs, size_t frameIndex)
+    {
+        vector<Color> pixels((size_t)options.w * options.h);
+        gs.drawView(options.logCellSize, options.centerX, options.centerY, pixels.data(), options.w, options.h, options.w * sizeof(Color), &tileCache);
+        ostringstream os;
+        if(options.png)
+            writePNG(os, pixels.data(), options.w, options.h, options.w * sizeof(Color));
+        else
+            writeRawRGB(os, pixels.data(), options.w, options.h, options.w * sizeof(Color));
+        string encoded = os.str();
+        bool written = true;
+        if(fileNamePattern != "")
+        {
+            ofstream file(getFileName(frameIndex).c_str(), ios::binary);
+            file.write(encoded.data(), encoded.size());
+            file.close();
+            written = (bool)file;
+        }
+        lock_guard<std::mutex> lockIt(theLock);
+        if(fileNamePattern == "")
         {
-            if(nodesMap.count(node) == 0)
+            encodedFrames[frameIndex] = std::move(encoded);
+            for(auto iter = encodedFrames.begin(); iter != encodedFrames.end() && iter->first == writtenCount; iter = encodedFrames.erase(iter))
             {
-                nodesMap[node] = nextNodeIndex++;
-                nodesList.push_back(node);
-                if(node->level > 0)
-                {
-                    newNodesSet.insert(node->nxny.nonleaf);
-                    newNodesSet.insert(node->nxpy.nonleaf);
-                    newNodesSet.insert(node->pxny.nonleaf);
-                    newNodesSet.insert(node->pxpy.nonleaf);
-                }
+                stream->write(iter->second.data(), iter->second.size());
+                writtenCount++;
             }
+            written = (bool)*stream;
         }
+        if(!written)
+            failed = true;
+        pendingCount--;
+        cond.notify_all();
+    }
+public:
+    // fileNamePattern is "" to write every frame to stream
+    FrameExporter(string fileNamePattern, ostream * stream, Options options, size_t threadCount)
+        : fileNamePattern(fileNamePattern), stream(stream), options(options), maxPendingCount(2 * threadCount), encoders(threadCount)
+    {
+        assert(fileNamePattern != "" || stream != nullptr);
     }
-    std::reverse(nodesList.begin(), nodesList.end());
-    for(NodeReference node : nodesList)
+    // a file name pattern has to have exactly one conversion, for an int
+    static bool isFileNamePattern(const string & fileName)
     {
-        string nodeName = getNodeString(nodesMap[node]);
-        nodeName.resize(10, ' ');
-        cout << nodeName << " : " << node->level << "\n    ";
-        string nxny, nxpy, pxny, pxpy;
-        if(node->level == 0)
+        size_t conversionCount = 0;
+        for(size_t i = 0; i < fileName.size(); i++)
         {
-            nxny = getCellString(node->nxny.leaf);
-            nxpy = getCellString(node->nxpy.leaf);
-            pxny = getCellString(node->pxny.leaf);
-            pxpy = getCellString(node->pxpy.leaf);
+            if(fileName[i] != '%')
+                continue;
+            if(i + 1 < fileName.size() && fileName[i + 1] == '%')
+            {
+                i++;
+                continue;
+            }
+            size_t end = fileName.find_first_not_of("0123456789", i + 1);
+            if(end == string::npos || fileName[end] != 'd')
+                return false;
+            conversionCount++;
+            i = end;
         }
-        else
+        return conversionCount == 1;
+    }
+    // waits while too many frames are being encoded
+    void submit(const GameState & gs)
+    {
+        size_t frameIndex;
         {
-            nxny = getNodeString(nodesMap[node->nxny.nonleaf]);
-            nxpy = getNodeString(nodesMap[node->nxpy.nonleaf]);
-            pxny = getNodeString(nodesMap[node->pxny.nonleaf]);
-            pxpy = getNodeString(nodesMap[node->pxpy.nonleaf]);
+            unique_lock<std::mutex> lockIt(theLock);
+            while(pendingCount >= maxPendingCount)
+                cond.wait(lockIt);
+            pendingCount++;
+            frameIndex = submittedCount++;
         }
-        nxny.resize(10, ' ');
-        nxpy.resize(10, ' ');
-        pxny.resize(10, ' ');
-        pxpy.resize(10, ' ');
-        cout << nxny << " " << pxny << "\n    " << nxpy << " " << pxpy << "\n";
-        if(node->level <= 3)
+        encoders.submit([this, gs, frameIndex]()
         {
-            cout << "\n" << getNodeGraphAsString(node);
-        }
-        cout << "\n";
+            encode(gs, frameIndex);
+        });
     }
-    cout << flush;
-}
+    // waits for every frame to be written; returns false if writing any of them failed
+    bool finish()
+    {
+        unique_lock<std::mutex> lockIt(theLock);
+        while(pendingCount > 0)
+            cond.wait(lockIt);
+        if(stream != nullptr && fileNamePattern == "")
+            stream->flush();
+        return !failed && (stream == nullptr || fileNamePattern != "" || *stream);
+    }
+};
 
-GameState readRLE(istream & is, NodeGCHashTable * gc)
+#ifdef USE_UNIX_SOCKETS
+// serves simulation jobs over a unix domain socket, so the node table and the memoized next states stay warm
+// and repeated or related jobs are mostly answered from the memo.
+// each connection sends one request per line and gets one response line per request, starting with "ok" or "error"
+// (a region response is followed by one line per row). requests from all the connections are queued for the worker threads,
+// which share one node table; the states are named and shared by all the connections.
+//   load <name> <file name>                  reads an .rle or macrocell file, responds with the generation and the population
+//   advance <name> <generation count>        responds with the new generation and population
+//   population <name>
+//   generation <name>
+//   bounds <name>                            the inclusive bounds of the non-background cells : min x, min y, max x, max y or empty
+//   region <name> <x> <y> <width> <height>   each row of cells as RLE cell codes (b, o, A, ...)
+//   export <name> <file name>                writes a macrocell file for names ending in .mc, an .rle file otherwise
+//   free <name>
+//   stats                                    the node count and the memo hit and miss counts
+//   shutdown                                 stops the server once the running requests are done
+class SimulationServer
 {
-    cout << "reading ...\x1b[K\r" << flush;
-    GameState retval = GameState(gc);
-    char xch, eq1, comma, ych, eq2, comma2, eq3;
-    int w, h;
-    string rule, ruleName;
-    while(is.peek() == '#')
+    SimulationServer(const SimulationServer &) = delete;
+    const SimulationServer &operator =(const SimulationServer &) = delete;
+private:
+    static constexpr uint64_t maxRegionCellCount = (uint64_t)1 << 20;
+    static constexpr size_t maxRequestSize = 1 << 16;
+    NodeGCHashTable * const gc;
+    struct NameLock
     {
-        is.ignore(10000, '\n');
+        std::mutex lock;
+        size_t userCount = 0;
+    };
+    std::mutex stateLock;
+    unordered_map<string, GameState> states;
+    unordered_map<string, unique_ptr<NameLock>> nameLocks; // guarded by stateLock; removed when no request uses them
+    int listenSocket = -1;
+    atomic_bool done;
+    std::mutex connectionLock;
+    condition_variable connectionCond;
+    unordered_set<int> connectionSockets; // each is served by a detached thread that removes it when done
+    ThreadPool workers; // the job queue
+    GameState getState(const string & name)
+    {
+        lock_guard<std::mutex> lockIt(stateLock);
+        auto iter = states.find(name);
+        if(iter == states.end())
+            return GameState(nullptr);
+        return iter->second;
+    }
+    void setState(const string & name, const GameState & gs)
+    {
+        lock_guard<std::mutex> lockIt(stateLock);
+        states.erase(name);
+        states.insert(make_pair(name, gs));
+    }
+    // requests naming the same state run one at a time, so a request can't overwrite what another one just stored
+    NameLock & acquireNameLock(const string & name)
+    {
+        NameLock * nameLock;
+        {
+            lock_guard<std::mutex> lockIt(stateLock);
+            unique_ptr<NameLock> & entry = nameLocks[name];
+            if(!entry)
+                entry.reset(new NameLock);
+            entry->userCount++;
+            nameLock = entry.get();
+        }
+        nameLock->lock.lock();
+        return *nameLock;
+    }
+    void releaseNameLock(const string & name, NameLock & nameLock)
+    {
+        nameLock.lock.unlock();
+        lock_guard<std::mutex> lockIt(stateLock);
+        if(--nameLock.userCount == 0)
+            nameLocks.erase(name);
+    }
+    static string describe(const GameState & gs)
+    {
+        ostringstream os;
+        os << "ok " << gs.generation << " " << gs.population();
+        return os.str();
+    }
+    // runs on a worker thread while the caller holds the name lock; files are read and written outside the
+    // MutatorScope, so gc never waits on the disk
+    string handleRequest(const string & request)
+    {
+        istringstream ss(request);
+        string command, name;
+        ss >> command >> name;
+        if(command == "shutdown")
+        {
+            done = true;
+            ::shutdown(listenSocket, SHUT_RDWR); // wakes up accept
+            return "ok";
+        }
+        if(command == "stats")
+        {
+            ostringstream os;
+            os << "ok " << gc->nodeCount << " " << gc->memoHitCount << " " << gc->memoMissCount;
+            return os.str();
+        }
+        static const unordered_set<string> commands{"load", "advance", "population", "generation", "bounds", "region", "export", "free"};
+        if(commands.count(command) == 0)
+            return "error unknown request '" + command + "'";
+        if(name == "")
+            return "error missing state name";
+        if(command == "load")
+        {
+            string fileName;
+            getline(ss >> ws, fileName);
+            ifstream is(fileName.c_str());
+            if(!is)
+                return "error can't open '" + fileName + "'";
+            ostringstream text;
+            text << is.rdbuf();
+            if(is.bad())
+                return "error reading '" + fileName + "' failed";
+            istringstream textStream(text.str());
+            GameState gs = nullptr;
+            {
+                MutatorScope mutatorScope(gc);
+                gs = readPattern(textStream, gc);
+            }
+            if(!gs)
+                return "error reading '" + fileName + "' failed";
+            setState(name, gs);
+            return describe(gs);
+        }
+        GameState gs = getState(name);
+        if(!gs)
+            return "error no state named '" + name + "'";
+        if(command == "free")
+        {
+            lock_guard<std::mutex> lockIt(stateLock);
+            states.erase(name);
+            return "ok";
+        }
+        if(command == "export")
+        {
+            string fileName;
+            getline(ss >> ws, fileName);
+            ostringstream text;
+            bool written;
+            {
+                MutatorScope mutatorScope(gc);
+                written = writePattern(text, gs, fileName);
+            }
+            if(!written)
+                return "error writing '" + fileName + "' failed";
+            ofstream os(fileName.c_str());
+            os << text.str();
+            os.close();
+            if(!os)
+                return "error writing '" + fileName + "' failed";
+            return "ok";
+        }
+        MutatorScope mutatorScope(gc);
+        if(command == "advance")
+        {
+            string value;
+            BigUnsigned generationCount;
+            if(!(ss >> value) || !BigUnsigned::parse(value, generationCount))
+                return "error invalid generation count";
+            gs.advance(generationCount);
+            setState(name, gs);
+            return describe(gs);
+        }
+        if(command == "population")
+            return "ok " + gs.population().toString();
+        if(command == "generation")
+            return "ok " + gs.generation.toString();
+        if(command == "bounds")
+        {
+            CellBounds bounds;
+            if(!getPatternBounds(gs, bounds))
+                return "error the pattern is too big";
+            if(bounds.empty)
+                return "ok empty";
+            ostringstream os;
+            os << "ok " << bounds.minX << " " << bounds.minY << " " << bounds.maxX << " " << bounds.maxY;
+            return os.str();
+        }
+        assert(command == "region");
+        int64_t x, y;
+        uint64_t w, h;
+        if(!(ss >> x >> y >> w >> h))
+            return "error invalid region";
+        if(w != 0 && h > maxRegionCellCount / w)
+            return "error the region is too big";
+        vector<CellType> cells((size_t)(w * h));
+        gs.getRegion(x, y, w, h, cells.data(), (size_t)w);
+        string retval = "ok";
+        for(uint64_t row = 0; row < h; row++)
+        {
+            retval += "\n";
+            for(uint64_t column = 0; column < w; column++)
+                retval += getRLECellCode(cells[(size_t)(column + row * w)]);
+        }
+        return retval;
     }
-    is >> xch >> eq1 >> w >> comma >> ych >> eq2 >> h >> comma2 >> ruleName >> eq3 >> rule;
-    is.ignore(10000, '\n');
-    if(!is)
+    // queues the request for the workers and waits for the response
+    string runRequest(const string & request)
     {
-        cout << "read failed.\x1b[K\n" << flush;
-        return nullptr;
+        string command, name;
+        istringstream(request) >> command >> name;
+        // taken here instead of on a worker, so workers never wait on each other
+        NameLock * nameLock = name.empty() ? nullptr : &acquireNameLock(name);
+        auto task = make_shared<packaged_task<string()>>([this, request]()
+        {
+            return handleRequest(request);
+        });
+        future<string> response = task->get_future();
+        workers.submit([task]()
+        {
+            (*task)();
+        });
+        string retval = response.get();
+        if(nameLock != nullptr)
+            releaseNameLock(name, *nameLock);
+        return retval;
     }
-    if(!parseRules(rule))
+    static bool writeAll(int fd, const string & str)
     {
-        setLifeRules();
-        cout << "read failed.\x1b[K\n" << flush;
-        return nullptr;
+        for(size_t written = 0; written < str.size();)
+        {
+            ssize_t writeCount = write(fd, str.data() + written, str.size() - written);
+            if(writeCount < 0 && errno == EINTR)
+                continue;
+            if(writeCount <= 0)
+                return false;
+            written += (size_t)writeCount;
+        }
+        return true;
     }
-    int x = 0, y = 0;
-    size_t currentCount = 0, popCount = 0;
-    while(is)
+    void serveConnection(int connectionSocket)
     {
-        int ch = is.get();
-        if(ch >= '0' && ch <= '9')
+        string buffer;
+        char chunk[4096];
+        while(!done)
         {
-            currentCount *= 10;
-            currentCount += ch - '0';
+            size_t lineEnd = buffer.find('\n');
+            if(lineEnd == string::npos)
+            {
+                if(buffer.size() > maxRequestSize)
+                {
+                    writeAll(connectionSocket, "error the request is too long\n");
+                    break;
+                }
+                ssize_t readCount = read(connectionSocket, chunk, sizeof(chunk));
+                if(readCount < 0 && errno == EINTR)
+                    continue;
+                if(readCount <= 0)
+                    break;
+                buffer.append(chunk, (size_t)readCount);
+                continue;
+            }
+            string request = buffer.substr(0, lineEnd);
+            buffer.erase(0, lineEnd + 1);
+            if(!request.empty() && request.back() == '\r')
+                request.pop_back();
+            if(request.find_first_not_of(" \t") == string::npos)
+                continue;
+            if(!writeAll(connectionSocket, runRequest(request) + "\n"))
+                break;
         }
-        else if(ch == 'b' || ch == '.')
+        lock_guard<std::mutex> lockIt(connectionLock);
+        close(connectionSocket);
+        connectionSockets.erase(connectionSocket);
+        connectionCond.notify_all();
+    }
+public:
+    SimulationServer(NodeGCHashTable * gc, size_t threadCount)
+        : gc(gc), done(false), workers(threadCount)
+    {
+    }
+    // serves requests until a shutdown request; returns false if the socket can't be opened
+    bool run(const string & socketPath)
+    {
+        sockaddr_un address;
+        memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if(socketPath.size() >= sizeof(address.sun_path))
         {
-            if(currentCount == 0)
-                currentCount = 1;
-            x += currentCount;
-            currentCount = 0;
+            cerr << "socket path too long : " << socketPath << endl;
+            return false;
         }
-        else if(ch == 'o')
+        memcpy(address.sun_path, socketPath.c_str(), socketPath.size());
+        struct stat fileStatus;
+        if(lstat(socketPath.c_str(), &fileStatus) == 0 && S_ISSOCK(fileStatus.st_mode))
         {
-            if(currentCount == 0)
-                currentCount = 1;
-            for(size_t i = 0; i < currentCount; i++, x++)
+            // replace a socket left behind by a server that is gone, but not one that is still running
+            int testSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+            bool inUse = testSocket >= 0 && connect(testSocket, (const sockaddr *)&address, sizeof(address)) == 0;
+            if(testSocket >= 0)
+                close(testSocket);
+            if(inUse)
             {
-                retval.setCell(x, y, 1);
-                if(++popCount % 1000 == 0)
-                    cout << "reading ... " << popCount << "\x1b[K\r" << flush;
+                cerr << "'" << socketPath << "' is already being served" << endl;
+                return false;
             }
-            currentCount = 0;
+            unlink(socketPath.c_str());
         }
-        else if(ch >= 'A' && ch <= 'X')
+        listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if(listenSocket < 0 || bind(listenSocket, (const sockaddr *)&address, sizeof(address)) != 0 || listen(listenSocket, 16) != 0)
         {
-            if(currentCount == 0)
-                currentCount = 1;
-            for(size_t i = 0; i < currentCount; i++, x++)
+            cerr << "can't listen on '" << socketPath << "'" << endl;
+            if(listenSocket >= 0)
+                close(listenSocket);
+            return false;
+        }
+        signal(SIGPIPE, SIG_IGN); // closed connections show up as failed writes instead
+        cout << "listening on '" << socketPath << "'" << endl;
+        while(!done)
+        {
+            int connectionSocket = accept(listenSocket, nullptr, nullptr);
+            if(connectionSocket < 0)
             {
-                retval.setCell(x, y, 1 + (int)ch - 'A');
-                if(++popCount % 1000 == 0)
-                    cout << "reading ... " << popCount << "\x1b[K\r" << flush;
+                if(errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                break;
             }
-            currentCount = 0;
+            lock_guard<std::mutex> lockIt(connectionLock);
+            connectionSockets.insert(connectionSocket);
+            thread([this, connectionSocket]()
+            {
+                serveConnection(connectionSocket);
+            }).detach();
         }
-        else if(ch == 'p')
+        done = true;
         {
-            if(currentCount == 0)
-                currentCount = 1;
-            ch = is.get();
-            if(ch >= 'A' && ch <= 'X')
+            // idle connections are woken up by ending their input; busy ones stop after their current request
+            unique_lock<std::mutex> lockIt(connectionLock);
+            for(int connectionSocket : connectionSockets)
+                ::shutdown(connectionSocket, SHUT_RD);
+            while(!connectionSockets.empty())
+                connectionCond.wait(lockIt);
+        }
+        close(listenSocket);
+        unlink(socketPath.c_str());
+        return true;
+    }
+};
+#endif // USE_UNIX_SOCKETS
+
+int main(int argc, char ** argv)
+{
+    string fName = "pattern.rle";
+    vector<string> patternFileNames;
+    bool showUsage = false;
+    string resumeFileName, checkpointFileName, outputFileName, daemonSocketPath, framesFileName;
+    double checkpointInterval = 60, autoStepSeconds = 0;
+    double autoStepTargetSeconds = 0; // 0 for the defaults : short steps in the window, so it keeps up, and longer ones headless
+    BigUnsigned advanceGenerationCount, periodSearchGenerationCount, frameStride(1);
+    uint64_t frameCount = 100;
+    FrameExporter::Options frameOptions;
+    bool headless = false;
+    uint64_t censusSoupCount = 0;
+    string censusSeed = "hashlife";
+    size_t threadCount = max<size_t>(1, thread::hardware_concurrency());
+    for(int i = 1; i < argc; i++)
+    {
+        string arg = argv[i];
+        if((arg == "--resume" || arg == "--checkpoint" || arg == "--checkpoint-interval" || arg == "--advance" || arg == "--output" || arg == "--auto-step" || arg == "--auto-step-target" || arg == "--find-period"
+                || arg == "--census" || arg == "--seed" || arg == "--threads" || arg == "--daemon" || arg == "--frames" || arg == "--frame-count"
+                || arg == "--frame-stride" || arg == "--frame-size" || arg == "--frame-center" || arg == "--frame-zoom") && i + 1 < argc)
+        {
+            string value = argv[++i];
+            if(arg == "--resume")
+                resumeFileName = value;
+            else if(arg == "--checkpoint")
+                checkpointFileName = value;
+            else if(arg == "--output")
+                outputFileName = value;
+            else if(arg == "--seed")
+                censusSeed = value;
+            else if(arg == "--daemon")
+                daemonSocketPath = value;
+            else if(arg == "--frames")
+                framesFileName = value;
+            else if(arg == "--frame-count")
             {
-                for(size_t i = 0; i < currentCount; i++, x++)
+                if(!(istringstream(value) >> frameCount) || frameCount == 0)
                 {
-                    retval.setCell(x, y, 25 + (int)ch - 'A');
-                    if(++popCount % 1000 == 0)
-                        cout << "reading ... " << popCount << "\x1b[K\r" << flush;
+                    cout << "invalid frame count : " << value << "\n";
+                    return 1;
                 }
             }
-            else
+            else if(arg == "--frame-stride")
             {
-                cout << "read failed.\x1b[K\n" << flush;
-                return nullptr;
+                if(!BigUnsigned::parse(value, frameStride) || !frameStride)
+                {
+                    cout << "invalid frame stride : " << value << "\n";
+                    return 1;
+                }
             }
-            currentCount = 0;
-        }
-        else if(ch >= 'q' && ch < 'y')
-        {
-            if(currentCount == 0)
-                currentCount = 1;
-            char oldCh = ch;
-            ch = is.get();
-            if(ch >= 'A' && ch <= 'Z')
+            else if(arg == "--frame-size")
             {
-                for(size_t i = 0; i < currentCount; i++, x++)
+                char separator = '\0';
+                if(!(istringstream(value) >> frameOptions.w >> separator >> frameOptions.h) || separator != 'x' || frameOptions.w <= 0 || frameOptions.h <= 0)
                 {
-                    retval.setCell(x, y, 49 + 26 * (int)(oldCh - 'q') + (int)ch - 'A');
-                    if(++popCount % 1000 == 0)
-                        cout << "reading ... " << popCount << "\x1b[K\r" << flush;
+                    cout << "invalid frame size : " << value << "\n";
+                    return 1;
                 }
             }
-            else
+            else if(arg == "--frame-center")
             {
-                cout << "read failed.\x1b[K\n" << flush;
-                return nullptr;
+                char separator = '\0';
+                if(!(istringstream(value) >> frameOptions.centerX >> separator >> frameOptions.centerY) || separator != ',')
+                {
+                    cout << "invalid frame center : " << value << "\n";
+                    return 1;
+                }
             }
-            currentCount = 0;
-        }
-        else if(ch == 'y')
-        {
-            if(currentCount == 0)
-                currentCount = 1;
-            ch = is.get();
-            if(ch >= 'A' && ch <= 'O')
+            else if(arg == "--frame-zoom")
             {
-                for(size_t i = 0; i < currentCount; i++, x++)
+                if(!(istringstream(value) >> frameOptions.logCellSize) || frameOptions.logCellSize < -64 || frameOptions.logCellSize > 16)
                 {
-                    retval.setCell(x, y, 241 + (int)ch - 'A');
-                    if(++popCount % 1000 == 0)
-                        cout << "reading ... " << popCount << "\x1b[K\r" << flush;
+                    cout << "invalid frame zoom : " << value << "\n";
+                    return 1;
                 }
             }
-            else
+            else if(arg == "--census")
             {
-                cout << "read failed.\x1b[K\n" << flush;
-                return nullptr;
+                if(!(istringstream(value) >> censusSoupCount) || censusSoupCount == 0)
+                {
+                    cout << "invalid soup count : " << value << "\n";
+                    return 1;
+                }
+            }
+            else if(arg == "--threads")
+            {
+                if(!(istringstream(value) >> threadCount) || threadCount == 0)
+                {
+                    cout << "invalid thread count : " << value << "\n";
+                    return 1;
+                }
+            }
+            else if(arg == "--advance")
+            {
+                if(!BigUnsigned::parse(value, advanceGenerationCount))
+                {
+                    cout << "invalid generation count : " << value << "\n";
+                    return 1;
+                }
+            }
+            else if(arg == "--find-period")
+            {
+                if(!BigUnsigned::parse(value, periodSearchGenerationCount))
+                {
+                    cout << "invalid generation count : " << value << "\n";
+                    return 1;
+                }
+            }
+            else if(arg == "--auto-step")
+            {
+                if(!(istringstream(value) >> autoStepSeconds) || autoStepSeconds < 0)
+                {
+                    cout << "invalid auto step time : " << value << "\n";
+                    return 1;
+                }
+            }
+            else if(arg == "--auto-step-target")
+            {
+                if(!(istringstream(value) >> autoStepTargetSeconds) || autoStepTargetSeconds <= 0)
+                {
+                    cout << "invalid auto step target time : " << value << "\n";
+                    return 1;
+                }
+            }
+            else if(!(istringstream(value) >> checkpointInterval) || checkpointInterval < 0)
+            {
+                cout << "invalid checkpoint interval : " << value << "\n";
+                return 1;
             }
-            currentCount = 0;
-        }
-        else if(ch == '$')
-        {
-            if(currentCount == 0)
-                currentCount = 1;
-            x = 0;
-            y += currentCount;
-            currentCount = 0;
         }
-        else if(ch == '!')
+        else if(arg == "--headless")
         {
-            cout << "read.\x1b[K\n" << flush;
-            return retval;
+            headless = true;
         }
-        else if(ch == ' ' || ch == '\r' || ch == '\n' || ch == '\t')
+        else if(arg == "-h" || arg == "--help" || arg.substr(0, 2) == "--")
         {
+            showUsage = true;
         }
         else
         {
-            cout << "read failed.\x1b[K\n" << flush;
-            return nullptr;
-        }
+            patternFileNames.push_back(arg);
+        }
+    }
+    // several patterns are only run side by side in headless mode, where each just gets advanced and reported
+    if(patternFileNames.size() > 1 && (!headless || resumeFileName != "" || checkpointFileName != "" || outputFileName != ""
+                                       || periodSearchGenerationCount || autoStepSeconds > 0 || framesFileName != ""))
+        showUsage = true;
+    if(framesFileName != "" && !headless)
+        showUsage = true;
+    if(daemonSocketPath != "" && (!patternFileNames.empty() || headless))
+        showUsage = true;
+    if(showUsage)
+    {
+        cout << "usage : hashlife [-h|--help] [--resume <checkpoint file name>]\n"
+                "                 [--checkpoint <checkpoint file name> [--checkpoint-interval <seconds>]]\n"
+                "                 [--advance <generation count>] [--auto-step-target <seconds>]\n"
+                "                 [--headless [--find-period <generation count>] [--auto-step <seconds>] [--output <rle file name>]\n"
+                "                             [--frames <file name>|- [--frame-count <frame count>] [--frame-stride <generation count>]\n"
+                "                              [--frame-size <width>x<height>] [--frame-center <x>,<y>] [--frame-zoom <log2 pixels per cell>]]]\n"
+                "                 [--census <soup count> [--seed <seed>]]\n"
+                "                 [--threads <thread count>]\n"
+                "                 [<pattern file name>]\n"
+                "       hashlife --headless [--advance <generation count>] [--threads <thread count>] <pattern file name>...\n"
+                "       hashlife --daemon <socket path> [--threads <thread count>]\n";
+        return 0;
+    }
+    streambuf * standardOutput = cout.rdbuf();
+    if(framesFileName == "-")
+        cout.rdbuf(cerr.rdbuf()); // the frames go to standard output, so the messages go to standard error
+    if(!patternFileNames.empty())
+        fName = patternFileNames.front();
+    static auto gc = new NodeGCHashTable;
+    static GameState gs = nullptr;
+    if(censusSoupCount > 0)
+    {
+        SoupCensus census(gc, censusSeed);
+        chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+        MultiverseRunner runner(threadCount);
+        census.run(censusSoupCount, runner);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+        census.writeReport(cout);
+        cout << "Soups per second : " << censusSoupCount / seconds << endl;
+        return 0;
+    }
+    if(daemonSocketPath != "")
+    {
+#ifdef USE_UNIX_SOCKETS
+        SimulationServer server(gc, threadCount);
+        return server.run(daemonSocketPath) ? 0 : 1;
+#else
+        cerr << "--daemon needs unix domain sockets" << endl;
+        return 1;
+#endif // USE_UNIX_SOCKETS
     }
-    cout << "read failed.\x1b[K\n" << flush;
-    return nullptr;
-}
-
-int main(int argc, char ** argv)
-{
-    setLifeRules();
-    string fName = "pattern.rle";
-    bool gotPattern = false;
-    for(int i = 1; i < argc; i++)
+    if(patternFileNames.size() > 1)
     {
-        string arg = argv[i];
-        if(arg == "-h" || arg == "--help" || gotPattern)
+        // advance all the patterns at once, sharing the node table
+        vector<GameState> states;
+        for(const string & patternFileName : patternFileNames)
         {
-            cout << "usage : hashlife [-h|--help] [<pattern file name>]\n";
-            return 0;
+            ifstream patternStream(patternFileName.c_str());
+            cout << "reading '" << patternFileName << "'...\n";
+            states.push_back(readPattern(patternStream, gc));
+            if(!states.back())
+                return 1;
         }
-        else
-            fName = arg;
+        MultiverseRunner runner(threadCount);
+        runner.advance(states, advanceGenerationCount);
+        for(size_t i = 0; i < states.size(); i++)
+            cout << patternFileNames[i] << " : Generation : " << states[i].generation << "     Population : " << states[i].population() << "     Level : " << states[i].rootNode->level << endl;
+        return 0;
+    }
+    if(resumeFileName != "")
+    {
+        cout << "reading '" << resumeFileName << "'...\n";
+        gs = readCheckpoint(resumeFileName, gc);
+    }
+    else
+    {
+        ifstream patternStream(fName.c_str());
+        cout << "reading '" << fName << "'...\n";
+        gs = readPattern(patternStream, gc);
+        patternStream.close();
     }
-    ifstream rleStream(fName.c_str());
-    cout << "reading '" << fName << "'...\n";
-    static auto gc = new NodeGCHashTable;
-    static GameState gs = readRLE(rleStream, gc);
-    rleStream.close();
     if(!gs)
         return 1;
+    if(headless)
+    {
+        // advance without a window, then report and save the result
+        if(periodSearchGenerationCount)
+        {
+            // step one generation at a time until the pattern repeats, then jump the rest of the way
+            PeriodDetector detector;
+            GameState startState = gs;
+            while(!detector.observe(gs) && gs.generation - startState.generation < periodSearchGenerationCount)
+                gs.step(0);
+            BigUnsigned searchedGenerationCount = gs.generation - startState.generation;
+            GameState jumpedState = nullptr;
+            if(detector.found())
+            {
+                cout << "Period : " << detector.getPeriod() << "     Displacement : " << detector.getDisplacementX() << ", " << detector.getDisplacementY() << endl;
+                if(searchedGenerationCount <= advanceGenerationCount)
+                    jumpedState = detector.jump(gs, advanceGenerationCount - searchedGenerationCount);
+            }
+            else
+                cout << "no period found in " << searchedGenerationCount << " generations" << endl;
+            gs = startState;
+            if(jumpedState)
+                gs = jumpedState;
+            else
+                gs.advance(advanceGenerationCount);
+        }
+        else
+            gs.advance(advanceGenerationCount);
+        if(autoStepSeconds > 0)
+        {
+            // hyperspeed : keep stepping with tuned step sizes until the time is up
+            StepSizeTuner tuner(autoStepTargetSeconds > 0 ? autoStepTargetSeconds : 0.5);
+            chrono::steady_clock::time_point endTime = chrono::steady_clock::now() + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(autoStepSeconds));
+            while(chrono::steady_clock::now() < endTime)
+            {
+                tuner.step(gs);
+                cout << "Generation : " << gs.generation << "     Step Size : " << tuner.getLogStepSize() << "\x1b[K\r" << flush;
+            }
+        }
+        if(framesFileName != "")
+        {
+            // the first frame is the advanced state; each frame is encoded while the next ones are stepped to
+            frameOptions.png = (framesFileName.size() >= 4 && framesFileName.compare(framesFileName.size() - 4, 4, ".png") == 0);
+            bool isPattern = FrameExporter::isFileNamePattern(framesFileName);
+            ostream standardOutputStream(standardOutput);
+            ofstream framesStream;
+            if(!isPattern && framesFileName != "-")
+                framesStream.open(framesFileName.c_str(), ios::binary);
+            ostream * stream = (isPattern ? nullptr : framesFileName == "-" ? &standardOutputStream : &framesStream);
+            FrameExporter exporter(isPattern ? framesFileName : "", stream, frameOptions, threadCount);
+            for(uint64_t frameIndex = 0; frameIndex < frameCount; frameIndex++)
+            {
+                if(frameIndex > 0)
+                    gs.advance(frameStride);
+                exporter.submit(gs);
+                cout << "Frame : " << frameIndex + 1 << " / " << frameCount << "     Generation : " << gs.generation << "\x1b[K\r" << flush;
+            }
+            cout << endl;
+            if(!exporter.finish())
+            {
+                cerr << "writing frames to '" << framesFileName << "' failed" << endl;
+                return 1;
+            }
+        }
+        cout << "Generation : " << gs.generation << "     Population : " << gs.population() << "     Level : " << gs.rootNode->level << endl;
+        if(outputFileName != "")
+        {
+            ofstream os(outputFileName.c_str());
+            bool written = writePattern(os, gs, outputFileName);
+            os.close();
+            if(!written || !os)
+            {
+                cerr << "writing '" << outputFileName << "' failed" << endl;
+                return 1;
+            }
+        }
+#ifndef __EMSCRIPTEN__
+        if(checkpointFileName != "" && !writeCheckpoint(checkpointFileName, gs))
+        {
+            cerr << "writing checkpoint '" << checkpointFileName << "' failed" << endl;
+            return 1;
+        }
+#endif // __EMSCRIPTEN__
+        return 0;
+    }
+#ifndef __EMSCRIPTEN__
+    static unique_ptr<CheckpointWriter> checkpointWriter;
+    if(checkpointFileName != "")
+        checkpointWriter.reset(new CheckpointWriter(checkpointFileName, chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(checkpointInterval))));
+#endif // __EMSCRIPTEN__
     //dump(rootNode);
     //cout << endl << endl;
     //dump(stepRoot(rootNode, gc, 5));
@@ -1892,11 +1176,28 @@ int main(int argc, char ** argv)
     }
 #endif
 
+#ifndef USE_SDL_1_x
+    static Uint32 stepDoneEventType = SDL_RegisterEvents(1);
+#else
+    static Uint32 stepDoneEventType = SDL_USEREVENT;
+#endif // USE_SDL_1_x
+    static SimulationWorker simulation(gs, []()
+    {
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = stepDoneEventType;
+        SDL_PushEvent(&event);
+    }, autoStepTargetSeconds > 0 ? autoStepTargetSeconds : 0.1);
+    gs = nullptr;
+    if(!advanceGenerationCount.isZero())
+        simulation.queueAdvance(advanceGenerationCount);
+
 #ifdef __EMSCRIPTEN__
     emscripten_set_main_loop([](){
 #endif
-    static bool done = false, canPause = false;
+    static bool done = false, canPause = false, showingProgress = false;
     static size_t stepSize = 0;
+    static GameState lastState = nullptr;
 
 #ifndef __EMSCRIPTEN__
     while(!done)
@@ -1910,9 +1211,14 @@ int main(int argc, char ** argv)
 #ifdef __EMSCRIPTEN__
         while(SDL_PollEvent(&event))
 #else
-        while(canPause ? SDL_WaitEvent(&event) : SDL_PollEvent(&event))
+        while(canPause ? (showingProgress ? SDL_WaitEventTimeout(&event, 100) : SDL_WaitEvent(&event)) : SDL_PollEvent(&event))
 #endif
         {
+            if(event.type == stepDoneEventType)
+            {
+                canPause = false;
+                continue;
+            }
             // check for messages
             switch(event.type)
             {
@@ -1936,6 +1242,11 @@ int main(int argc, char ** argv)
                     doStep = true;
                     canPause = false;
                 }
+                if(event.key.keysym.sym == SDLK_c || event.key.keysym.sym == SDLK_BACKSPACE)
+                {
+                    simulation.cancelAll();
+                    canPause = false;
+                }
                 if(event.key.keysym.sym == SDLK_PLUS || event.key.keysym.sym == SDLK_EQUALS || event.key.keysym.sym == SDLK_a)
                 {
                     stepSize++;
@@ -1947,18 +1258,56 @@ int main(int argc, char ** argv)
                         stepSize--;
                     canPause = false;
                 }
+                if(event.key.keysym.sym == SDLK_r)
+                {
+                    simulation.rewind();
+                    canPause = false;
+                }
+                if(event.key.keysym.sym == SDLK_h)
+                {
+                    simulation.setAutoStep(!simulation.isAutoStep(), stepSize);
+                    canPause = false;
+                }
+                if(event.key.keysym.sym == SDLK_e)
+                {
+                    ofstream os("export.rle");
+                    bool written = writeRLE(os, simulation.getState());
+                    os.close();
+                    if(!written || !os)
+                        cerr << "writing 'export.rle' failed" << endl;
+                }
 
                 break;
             }
             } // end switch
         } // end of message processing
+        if(doStep)
+            simulation.queueStep(stepSize);
+#ifdef __EMSCRIPTEN__
+        simulation.idle();
+#endif // __EMSCRIPTEN__
+        bool autoStepping = simulation.isAutoStep();
+        if(autoStepping)
+            stepSize = simulation.getAutoLogStepSize();
+        GameState state = simulation.getState();
+        bool stepping = simulation.isStepping();
+        size_t queuedCount = simulation.getQueuedCount() + (stepping ? 1 : 0);
 #ifdef __EMSCRIPTEN__
         ostringstream textStream;
         textStream
 #else
         cout
 #endif
-         << "Step Size : " << stepSize << "     Level : " << gs.rootNode->level;
+         << "Generation : " << state.generation << "     Population : " << state.population() << "     Step Size : " << stepSize << (autoStepping ? " (auto)" : "") << "     Level : " << state.rootNode->level << "     Queued Steps : " << queuedCount;
+        if(stepping)
+        {
+#ifdef __EMSCRIPTEN__
+            textStream
+#else
+            cout
+#endif
+             << "     Progress : " << (int)(100 * simulation.getProgress()) << "%";
+        }
 #ifdef __EMSCRIPTEN__
         static string lastLogString = "";
         string logString = textStream.str();
@@ -1970,37 +1319,58 @@ int main(int argc, char ** argv)
 #else
         cout << "\x1b[K\r" << flush;
 #endif // __EMSCRIPTEN__
-        if(doStep)
-            gs.step(stepSize);
+        if(lastState.rootNode != state.rootNode || lastState.backgroundType != state.backgroundType || lastState.generation != state.generation)
+        {
+#ifndef __EMSCRIPTEN__
+            if(checkpointWriter && lastState)
+                checkpointWriter->stateChanged(state);
+#endif // __EMSCRIPTEN__
+            lastState = state;
+        }
 
 
-        void *pixels;
-        int pitch;
+        static ThreadPool renderThreadPool;
+        static ViewRenderer viewRenderer(&renderThreadPool);
+        if(!viewRenderer.isCurrent(state, 8, w, h))
+        {
+            void *pixels;
+            int pitch;
+#ifdef USE_SDL_1_x
+            SDL_LockSurface(texture);
+            pixels = texture->pixels;
+            pitch = texture->pitch;
+#else
+            SDL_LockTexture(texture, nullptr, &pixels, &pitch);
+#endif // USE_SDL_1_x
+            viewRenderer.draw(state, 8, pixels, w, h, pitch);
 #ifdef USE_SDL_1_x
-        SDL_LockSurface(texture);
-        pixels = texture->pixels;
-        pitch = texture->pitch;
+            SDL_UnlockSurface(texture);
 #else
-        SDL_LockTexture(texture, nullptr, &pixels, &pitch);
+            SDL_UnlockTexture(texture);
 #endif // USE_SDL_1_x
-        gs.draw(8, pixels, w, h, pitch);
+        }
 #ifdef USE_SDL_1_x
-        SDL_UnlockSurface(texture);
         SDL_BlitSurface(texture, nullptr, screen, nullptr);
         SDL_Flip(screen);
 #else
-        SDL_UnlockTexture(texture);
         SDL_RenderClear(renderer);
         SDL_RenderCopy(renderer, texture, nullptr, nullptr);
         SDL_RenderPresent(renderer);
 #endif
 #ifndef __EMSCRIPTEN__
-        if(!doStep)
-            canPause = true;
+        canPause = true; // the worker sends an event when a step finishes
+        showingProgress = stepping;
 #endif
     } // end main loop
 #ifdef __EMSCRIPTEN__
     , 0, true);
+#else
+    simulation.cancelQueued();
+    if(checkpointWriter)
+    {
+        checkpointWriter->request(simulation.getState());
+        checkpointWriter.reset();
+    }
 #endif
     return 0;
 }